@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+"""Benchmark runner for fastawc.
+
+Sweeps flag combinations, input types, page cache state and thread counts,
+times fastawc against GNU wc and reports throughput with 95% confidence
+intervals. Runs anywhere Python 3 runs; cold cache runs need
+posix_fadvise (Linux) and are skipped elsewhere.
+"""
+import argparse
+import csv
+import math
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+import time
+
+# Two-sided 95% Student t quantiles by degrees of freedom.
+T95 = {1: 12.706, 2: 4.303, 3: 3.182, 4: 2.776, 5: 2.571, 6: 2.447, 7: 2.365,
+       8: 2.306, 9: 2.262, 10: 2.228, 12: 2.179, 15: 2.131, 20: 2.086,
+       25: 2.060, 30: 2.042}
+
+
+def t95(df):
+    if df <= 0:
+        return float("nan")
+    for k in sorted(T95):
+        if df <= k:
+            return T95[k]
+    return 1.960
+
+
+# gencorpus arguments for each input type.
+INPUTS = {
+    "ascii": ["--script=ascii", "--line-len=uniform:40:120"],
+    "utf8": ["--script=ascii:2,latin1:1,greek:1,cyrillic:3,cjk:2,emoji:1", "--line-len=uniform:40:120"],
+    "long": ["--line-len=uniform:262144:1048576"],
+    "short": ["--line-len=uniform:0:4"],
+    "space": ["--space=0.8", "--line-len=uniform:40:120"],
+    "crlf": ["--crlf=1", "--line-len=exp:60"],
+    "invalid": ["--script=ascii:1,cyrillic:1", "--invalid=0.05"],
+    "empty-lines": ["--line-len=fixed:0"],
+    "one-line": ["--line-len=fixed:1000000000000"],
+}
+DEFAULT_INPUTS = "ascii,utf8,long,short,space"
+
+
+def make_input(gencorpus, kind, path, size, seed):
+    if os.path.exists(path) and os.path.getsize(path) == size:
+        return
+    subprocess.run([gencorpus, f"--size={size}", f"--seed={seed}", f"--output={path}", *INPUTS[kind]], check=True)
+    fd = os.open(path, os.O_RDONLY)
+    try:
+        os.fsync(fd)
+    finally:
+        os.close(fd)
+
+
+def evict(path):
+    if not hasattr(os, "posix_fadvise"):
+        return False
+    fd = os.open(path, os.O_RDONLY)
+    try:
+        os.fdatasync(fd)
+        os.posix_fadvise(fd, 0, 0, os.POSIX_FADV_DONTNEED)
+    finally:
+        os.close(fd)
+    return True
+
+
+def warm(path):
+    with open(path, "rb") as f:
+        while f.read(16 << 20):
+            pass
+
+
+def run_once(cmd, path, cache, env):
+    if cache == "cold":
+        evict(path)
+    else:
+        warm(path)
+    t0 = time.perf_counter()
+    p = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, env=env)
+    dt = time.perf_counter() - t0
+    if p.returncode != 0:
+        raise RuntimeError(f"{' '.join(cmd)}: exit {p.returncode}: {p.stderr.decode(errors='replace').strip()}")
+    return dt, p.stdout
+
+
+def numbers(out):
+    first = out.decode(errors="replace").splitlines()[0].split()
+    return [int(x) for x in first if x.isdigit()]
+
+
+def summarize(times, size):
+    mean = statistics.mean(times)
+    sd = statistics.stdev(times) if len(times) > 1 else 0.0
+    ci = t95(len(times) - 1) * sd / math.sqrt(len(times)) if len(times) > 1 else float("nan")
+    gbs = [size / t / 1e9 for t in times]
+    gmean = statistics.mean(gbs)
+    gsd = statistics.stdev(gbs) if len(gbs) > 1 else 0.0
+    gci = t95(len(gbs) - 1) * gsd / math.sqrt(len(gbs)) if len(gbs) > 1 else float("nan")
+    return mean, ci, gmean, gci
+
+
+def split_list(s):
+    return [x for x in s.split(",") if x]
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("--fastawc", default="./fastawc", help="fastawc binary")
+    ap.add_argument("--gencorpus", default="./gencorpus", help="corpus generator binary")
+    ap.add_argument("--wc", default=shutil.which("wc"), help="reference wc binary, '' to skip")
+    ap.add_argument("--workdir", default="bench-data", help="where generated inputs live")
+    ap.add_argument("--size-mb", type=int, default=1024, help="size of each input in MiB")
+    ap.add_argument("--runs", type=int, default=10)
+    ap.add_argument("--seed", type=int, default=1)
+    ap.add_argument("--flags", default="-l,-lw,-lwm,-c,-lwc", help="comma separated flag sets")
+    ap.add_argument("--inputs", default=DEFAULT_INPUTS,
+                    help="comma separated input types: " + ", ".join(INPUTS))
+    ap.add_argument("--cache", default="warm,cold", help="warm, cold or both")
+    ap.add_argument("--threads", default="1", help="comma separated thread counts (>1 passes --threads=N)")
+    ap.add_argument("--wc-locale", default="C.UTF-8", help="LC_ALL for the reference wc")
+    ap.add_argument("--csv", help="also write results to this CSV file")
+    args = ap.parse_args()
+
+    for tool in (args.fastawc, args.gencorpus):
+        if not shutil.which(tool) and not os.path.exists(tool):
+            sys.exit(f"bench.py: {tool} not found")
+    os.makedirs(args.workdir, exist_ok=True)
+    size = args.size_mb << 20
+    caches = split_list(args.cache)
+    if "cold" in caches and not hasattr(os, "posix_fadvise"):
+        print("bench.py: cold cache runs need posix_fadvise, skipping", file=sys.stderr)
+        caches.remove("cold")
+
+    wc_env = dict(os.environ, LC_ALL=args.wc_locale)
+    header = ["input", "flags", "cache", "threads", "tool", "runs",
+              "mean_s", "ci95_s", "gbps", "ci95_gbps", "vs_wc", "match"]
+    rows = []
+    print(f"{'input':<11} {'flags':<6} {'cache':<5} {'thr':>3} {'tool':<8} "
+          f"{'mean s':>9} {'+-95%':>8} {'GB/s':>8} {'+-95%':>7} {'vs wc':>6} match")
+
+    for kind in split_list(args.inputs):
+        path = os.path.join(args.workdir, f"{kind}-{args.size_mb}m-{args.seed}.txt")
+        make_input(args.gencorpus, kind, path, size, args.seed)
+        for flags in split_list(args.flags):
+            for cache in caches:
+                ref = None
+                ref_nums = None
+                if args.wc:
+                    cmd = [args.wc, flags, path]
+                    times = []
+                    for _ in range(args.runs):
+                        dt, out = run_once(cmd, path, cache, wc_env)
+                        times.append(dt)
+                    ref_nums = numbers(out)
+                    ref = summarize(times, size)
+                    rows.append([kind, flags, cache, 1, "wc", args.runs, *ref, 1.0, "-"])
+                for thr in split_list(args.threads):
+                    cmd = [args.fastawc, flags] + ([f"--threads={thr}"] if int(thr) > 1 else []) + [path]
+                    times = []
+                    for _ in range(args.runs):
+                        dt, out = run_once(cmd, path, cache, None)
+                        times.append(dt)
+                    res = summarize(times, size)
+                    ratio = ref[0] / res[0] if ref else float("nan")
+                    match = "-" if ref_nums is None or "L" in flags else ("yes" if numbers(out) == ref_nums else "no")
+                    rows.append([kind, flags, cache, int(thr), "fastawc", args.runs, *res, ratio, match])
+                for r in rows[-(len(split_list(args.threads)) + (1 if ref else 0)):]:
+                    print(f"{r[0]:<11} {r[1]:<6} {r[2]:<5} {r[3]:>3} {r[4]:<8} "
+                          f"{r[6]:>9.4f} {r[7]:>8.4f} {r[8]:>8.3f} {r[9]:>7.3f} {r[10]:>6.2f} {r[11]}")
+                sys.stdout.flush()
+
+    if args.csv:
+        with open(args.csv, "w", newline="") as f:
+            w = csv.writer(f)
+            w.writerow(header)
+            w.writerows(rows)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Seeded synthetic corpus generator. Output depends only on the arguments:
+// the PRNG and all distributions are implemented here rather than taken
+// from <random>, whose distributions differ between standard libraries.
+
+struct Rng {
+	uint64_t s[4];
+	explicit Rng(uint64_t seed) {
+		for (auto& x : s) {
+			seed += 0x9E3779B97F4A7C15ull;
+			uint64_t z = seed;
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			x = z ^ (z >> 31);
+		}
+	}
+	static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+	uint64_t next() {
+		uint64_t r = rotl(s[1] * 5, 7) * 9;
+		uint64_t t = s[1] << 17;
+		s[2] ^= s[0]; s[3] ^= s[1]; s[1] ^= s[2]; s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = rotl(s[3], 45);
+		return r;
+	}
+	double unit() { return (double)(next() >> 11) * (1.0 / 9007199254740992.0); }
+	uint64_t below(uint64_t n) { return n ? next() % n : 0; }
+	bool chance(double p) { return p > 0 && unit() < p; }
+};
+
+struct LengthDist {
+	enum Kind { kFixed, kUniform, kExp, kLogNormal } kind = kUniform;
+	double a = 40, b = 120;
+	uint64_t draw(Rng& r) const {
+		switch (kind) {
+		case kFixed: return (uint64_t)a;
+		case kUniform: return (uint64_t)a + r.below((uint64_t)b - (uint64_t)a + 1);
+		case kExp: return (uint64_t)(-std::log(1.0 - r.unit()) * a);
+		case kLogNormal: {
+			double u1 = 1.0 - r.unit(), u2 = r.unit();
+			double z = std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+			return (uint64_t)std::exp(a + b * z);
+		}
+		}
+		return 0;
+	}
+};
+
+struct Script {
+	const char* name;
+	uint32_t lo, hi;
+};
+
+static const Script kScripts[] = {
+	{ "ascii", 0x21, 0x7E },
+	{ "latin1", 0xC0, 0xFF },
+	{ "greek", 0x3B1, 0x3C9 },
+	{ "cyrillic", 0x430, 0x44F },
+	{ "arabic", 0x627, 0x64A },
+	{ "cjk", 0x4E00, 0x9FFF },
+	{ "hangul", 0xAC00, 0xD7A3 },
+	{ "emoji", 0x1F600, 0x1F64F },
+};
+
+static uint64_t parseSize(const std::string& s) {
+	char* end = nullptr;
+	double v = strtod(s.c_str(), &end);
+	switch (*end) {
+	case 'k': case 'K': v *= 1024.0; break;
+	case 'm': case 'M': v *= 1024.0 * 1024; break;
+	case 'g': case 'G': v *= 1024.0 * 1024 * 1024; break;
+	case 't': case 'T': v *= 1024.0 * 1024 * 1024 * 1024; break;
+	}
+	return (uint64_t)v;
+}
+
+static bool parseDist(const std::string& s, LengthDist& d) {
+	std::string kind = s.substr(0, s.find(':'));
+	double a = 0, b = 0;
+	int n = sscanf(s.c_str() + kind.size(), ":%lf:%lf", &a, &b);
+	if (kind == "fixed" && n == 1) d.kind = LengthDist::kFixed;
+	else if (kind == "uniform" && n == 2 && b >= a) d.kind = LengthDist::kUniform;
+	else if (kind == "exp" && n == 1) d.kind = LengthDist::kExp;
+	else if (kind == "lognormal" && n == 2) d.kind = LengthDist::kLogNormal;
+	else return false;
+	d.a = a;
+	d.b = b;
+	return true;
+}
+
+static size_t encodeUtf8(uint32_t cp, unsigned char* o) {
+	if (cp < 0x80) { o[0] = (unsigned char)cp; return 1; }
+	if (cp < 0x800) { o[0] = (unsigned char)(0xC0 | (cp >> 6)); o[1] = (unsigned char)(0x80 | (cp & 0x3F)); return 2; }
+	if (cp < 0x10000) {
+		o[0] = (unsigned char)(0xE0 | (cp >> 12));
+		o[1] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+		o[2] = (unsigned char)(0x80 | (cp & 0x3F));
+		return 3;
+	}
+	o[0] = (unsigned char)(0xF0 | (cp >> 18));
+	o[1] = (unsigned char)(0x80 | ((cp >> 12) & 0x3F));
+	o[2] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+	o[3] = (unsigned char)(0x80 | (cp & 0x3F));
+	return 4;
+}
+
+static void usage() {
+	fprintf(stderr,
+		"usage: gencorpus [options]\n"
+		"  --size=N            output size, K/M/G/T suffixes (default 64M)\n"
+		"  --seed=N            PRNG seed (default 1)\n"
+		"  --line-len=DIST     characters per line: fixed:N, uniform:MIN:MAX,\n"
+		"                      exp:MEAN, lognormal:MU:SIGMA (default uniform:40:120)\n"
+		"  --space=F           fraction of characters that are whitespace (default 0.17)\n"
+		"  --script=S:W,...    weighted script mix of ascii, latin1, greek, cyrillic,\n"
+		"                      arabic, cjk, hangul, emoji (default ascii:1)\n"
+		"  --crlf=F            fraction of line ends written as CRLF (default 0)\n"
+		"  --invalid=F         fraction of characters replaced by invalid UTF-8 (default 0)\n"
+		"  --output=FILE       write to FILE instead of stdout\n");
+}
+
+int main(int argc, char** argv) {
+	uint64_t size = 64ull << 20;
+	uint64_t seed = 1;
+	LengthDist lineLen;
+	double space = 0.17, crlf = 0, invalid = 0;
+	std::vector<std::pair<const Script*, double>> mix = { { &kScripts[0], 1.0 } };
+	std::string output = "-";
+
+	for (int i = 1; i < argc; ++i) {
+		std::string a = argv[i];
+		std::string v = a.find('=') != std::string::npos ? a.substr(a.find('=') + 1) : "";
+		if (a.rfind("--size=", 0) == 0) size = parseSize(v);
+		else if (a.rfind("--seed=", 0) == 0) seed = strtoull(v.c_str(), nullptr, 10);
+		else if (a.rfind("--line-len=", 0) == 0) {
+			if (!parseDist(v, lineLen)) { fprintf(stderr, "gencorpus: bad distribution %s\n", v.c_str()); return 2; }
+		}
+		else if (a.rfind("--space=", 0) == 0) space = atof(v.c_str());
+		else if (a.rfind("--crlf=", 0) == 0) crlf = atof(v.c_str());
+		else if (a.rfind("--invalid=", 0) == 0) invalid = atof(v.c_str());
+		else if (a.rfind("--output=", 0) == 0) output = v;
+		else if (a.rfind("--script=", 0) == 0) {
+			mix.clear();
+			size_t pos = 0;
+			while (pos <= v.size()) {
+				size_t comma = v.find(',', pos);
+				std::string item = v.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+				std::string name = item.substr(0, item.find(':'));
+				double w = item.find(':') != std::string::npos ? atof(item.c_str() + name.size() + 1) : 1.0;
+				const Script* sc = nullptr;
+				for (const auto& s : kScripts) if (name == s.name) sc = &s;
+				if (!sc || w <= 0) { fprintf(stderr, "gencorpus: bad script %s\n", item.c_str()); return 2; }
+				mix.push_back({ sc, w });
+				if (comma == std::string::npos) break;
+				pos = comma + 1;
+			}
+		}
+		else { usage(); return 2; }
+	}
+
+	double wsum = 0;
+	for (auto& m : mix) wsum += m.second;
+	for (auto& m : mix) m.second /= wsum;
+
+	FILE* out = stdout;
+	if (output != "-") {
+		out = fopen(output.c_str(), "wb");
+		if (!out) { fprintf(stderr, "gencorpus: cannot open %s\n", output.c_str()); return 1; }
+	}
+
+	static const unsigned char kSpaces[] = { ' ', ' ', ' ', ' ', ' ', ' ', ' ', '\t', '\t', '\r', '\v', '\f' };
+	static const unsigned char kInvalid[] = { 0x80, 0xBF, 0xC0, 0xC1, 0xF5, 0xFF, 0xE2, 0xF0 };
+
+	Rng rng(seed);
+	const size_t kChunk = 1u << 20;
+	std::vector<unsigned char> buf;
+	buf.reserve(kChunk);
+	uint64_t written = 0;
+	uint64_t lineLeft = lineLen.draw(rng);
+	while (written < size) {
+		buf.clear();
+		while (buf.size() + 8 < kChunk) {
+			if (lineLeft == 0) {
+				if (rng.chance(crlf)) buf.push_back('\r');
+				buf.push_back('\n');
+				lineLeft = lineLen.draw(rng);
+				continue;
+			}
+			--lineLeft;
+			if (rng.chance(space)) {
+				buf.push_back(kSpaces[rng.below(sizeof(kSpaces))]);
+				continue;
+			}
+			if (rng.chance(invalid)) {
+				buf.push_back(kInvalid[rng.below(sizeof(kInvalid))]);
+				continue;
+			}
+			const Script* sc = mix.back().first;
+			double u = rng.unit();
+			for (const auto& m : mix) {
+				if (u < m.second) { sc = m.first; break; }
+				u -= m.second;
+			}
+			unsigned char tmp[4];
+			size_t n = encodeUtf8(sc->lo + (uint32_t)rng.below(sc->hi - sc->lo + 1), tmp);
+			buf.insert(buf.end(), tmp, tmp + n);
+		}
+		size_t n = (size_t)std::min<uint64_t>(buf.size(), size - written);
+		if (fwrite(buf.data(), 1, n, out) != n) {
+			fprintf(stderr, "gencorpus: write failed\n");
+			return 1;
+		}
+		written += n;
+	}
+	if (out != stdout) fclose(out);
+	else fflush(out);
+	return 0;
+}
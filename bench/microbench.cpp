@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "../fastawc/kernels.h"
+#include "../fastawc/perf_counters.h"
+#include "microbench.h"
+
+volatile uint64_t gSink;
+
+static uint64_t readTsc() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static std::vector<unsigned char> makeInput(const std::string& kind, size_t size) {
+	std::mt19937_64 rng(42);
+	std::vector<unsigned char> buf;
+	buf.reserve(size + 64);
+	static const char* kUtf8[] = { "\xD0\xBF\xD1\x80\xD0\xB8", "\xE6\x97\xA5\xE6\x9C\xAC", "ab", "\xF0\x9F\x98\x80" };
+	while (buf.size() < size) {
+		if (kind == "random") {
+			buf.push_back((unsigned char)rng());
+		}
+		else if (kind == "utf8") {
+			const char* w = kUtf8[rng() % 4];
+			buf.insert(buf.end(), w, w + strlen(w));
+			buf.push_back(rng() % 12 == 0 ? '\n' : ' ');
+		}
+		else {
+			size_t len = 1 + rng() % 9;
+			for (size_t i = 0; i < len; ++i) buf.push_back((unsigned char)('a' + rng() % 26));
+			buf.push_back(rng() % 12 == 0 ? '\n' : ' ');
+		}
+	}
+	buf.resize(size);
+	return buf;
+}
+
+struct Result {
+	double nsPerByte = 0;
+	double tscPerByte = 0;
+	PerfSample perf;
+};
+
+static Result measure(PerfCounters& pc, size_t bytes, double minSeconds, const std::function<void()>& body) {
+	body();
+	size_t reps = 1;
+	for (;;) {
+		auto t0 = std::chrono::steady_clock::now();
+		for (size_t r = 0; r < reps; ++r) body();
+		double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		if (s >= minSeconds / 10) break;
+		reps *= 2;
+	}
+	Result best;
+	best.nsPerByte = 1e300;
+	for (int round = 0; round < 10; ++round) {
+		pc.start();
+		uint64_t c0 = readTsc();
+		auto t0 = std::chrono::steady_clock::now();
+		for (size_t r = 0; r < reps; ++r) body();
+		auto t1 = std::chrono::steady_clock::now();
+		uint64_t c1 = readTsc();
+		PerfSample ps = pc.stop();
+		double total = (double)bytes * reps;
+		double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / total;
+		if (ns < best.nsPerByte) {
+			best.nsPerByte = ns;
+			best.tscPerByte = (double)(c1 - c0) / total;
+			best.perf = ps;
+			for (int e = 0; e < kPerfEventCount; ++e) best.perf.value[e] = (uint64_t)(ps.value[e] / (double)reps);
+		}
+	}
+	return best;
+}
+
+static void report(const char* kernel, const std::string& input, size_t bytes, const Result& r) {
+	printf("%-24s %-7s %8.4f %8.2f %9.3f", kernel, input.c_str(), r.nsPerByte, 1.0 / r.nsPerByte, r.tscPerByte);
+	for (int e = 0; e < kPerfEventCount; ++e) {
+		if (r.perf.valid[e]) printf(" %15.4f", (double)r.perf.value[e] / bytes);
+		else printf(" %15s", "n/a");
+	}
+	printf("\n");
+}
+
+int main(int argc, char** argv) {
+	initSpaceTable();
+	size_t size = 256u << 10;
+	double minSeconds = 0.2;
+	std::string only;
+	std::vector<std::string> inputs = { "ascii", "utf8", "random" };
+	for (int i = 1; i < argc; ++i) {
+		std::string a = argv[i];
+		if (a.rfind("--size=", 0) == 0) size = strtoull(a.c_str() + 7, nullptr, 10);
+		else if (a.rfind("--min-time=", 0) == 0) minSeconds = atof(a.c_str() + 11);
+		else if (a.rfind("--kernel=", 0) == 0) only = a.substr(9);
+		else if (a.rfind("--input=", 0) == 0) inputs = { a.substr(8) };
+		else {
+			fprintf(stderr, "usage: microbench [--size=BYTES] [--min-time=SEC] [--kernel=NAME] [--input=ascii|utf8|random]\n");
+			return 2;
+		}
+	}
+	size &= ~(size_t)63;
+	if (size == 0) size = 64;
+
+	PerfCounters pc;
+	if (!pc.any()) fprintf(stderr, "microbench: hardware counters unavailable, reporting TSC only\n");
+	printf("%-24s %-7s %8s %8s %9s", "kernel", "input", "ns/B", "GB/s", "tsc/B");
+	for (int e = 0; e < kPerfEventCount; ++e) printf(" %13s/B", kPerfEventNames[e]);
+	printf("\n");
+
+	for (const auto& input : inputs) {
+		std::vector<unsigned char> buf = makeInput(input, size);
+		const unsigned char* p = buf.data();
+		BenchRun run = [&](const std::string& name, size_t bytes, const std::function<void()>& body) {
+			if (!only.empty() && only != name) return;
+			report(name.c_str(), input, bytes, measure(pc, bytes, minSeconds, body));
+		};
+
+		for (const BenchIsa* isa : { sse2Bench(), avx2Bench(), avx512Bench(), neonBench(), sveBench() })
+			if (isa && isa->supported()) isa->run(run, p, size);
+		run("processSwar", size, [&] {
+			Counts c{};
+			KernelState st{};
+			processSwar(p, size, c, st, true, true, true, true, false);
+			gSink = c.lineCount + c.wordCount + c.charCount + c.byteCount;
+		});
+		run("processSwar-L", size, [&] {
+			Counts c{};
+			KernelState st{};
+			processSwar(p, size, c, st, true, true, true, true, true);
+			finalizeScalar(c, st, true);
+			gSink = c.maxLineLength;
+		});
+		run("processScalar", size, [&] {
+			Counts c{};
+			ScalarState st{};
+			processScalar(p, size, c, st, true, true, true, true, false);
+			gSink = c.lineCount + c.wordCount + c.charCount + c.byteCount;
+		});
+		run("processScalar-L", size, [&] {
+			Counts c{};
+			ScalarState st{};
+			processScalar(p, size, c, st, true, true, true, true, true);
+			finalizeScalar(c, st, true);
+			gSink = c.maxLineLength;
+		});
+	}
+	return 0;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Times body over bytes of input and reports it as name (skipped when
+// --kernel names another).
+using BenchRun = std::function<void(const std::string& name, size_t bytes, const std::function<void()>& body)>;
+
+// Results are stored here so the compiler keeps the work.
+extern volatile uint64_t gSink;
+
+// The benchmarks of one vector instruction set. Each lives in its own
+// translation unit built with that ISA's flags, as the kernels do, and is
+// nullptr when this build has none for it.
+struct BenchIsa {
+	const char* name;
+	bool (*supported)();
+	void (*run)(const BenchRun& run, const unsigned char* p, size_t size);
+};
+
+const BenchIsa* sse2Bench();
+const BenchIsa* avx2Bench();
+const BenchIsa* avx512Bench();
+const BenchIsa* neonBench();
+const BenchIsa* sveBench();
@@ -0,0 +1,14 @@
+#include "microbench_simd.h"
+
+#ifdef __AVX2__
+static void bench(const BenchRun& run, const unsigned char* p, size_t size) {
+	benchSimd<Avx2>(run, p, size);
+}
+
+const BenchIsa* avx2Bench() {
+	static const BenchIsa b = { "avx2", avx2Kernel()->supported, bench };
+	return &b;
+}
+#else
+const BenchIsa* avx2Bench() { return nullptr; }
+#endif
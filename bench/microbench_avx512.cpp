@@ -0,0 +1,14 @@
+#include "microbench_simd.h"
+
+#ifdef __AVX512BW__
+static void bench(const BenchRun& run, const unsigned char* p, size_t size) {
+	benchSimd<Avx512>(run, p, size);
+}
+
+const BenchIsa* avx512Bench() {
+	static const BenchIsa b = { "avx512", avx512Kernel()->supported, bench };
+	return &b;
+}
+#else
+const BenchIsa* avx512Bench() { return nullptr; }
+#endif
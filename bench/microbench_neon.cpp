@@ -0,0 +1,20 @@
+#include "microbench_simd.h"
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+static void bench(const BenchRun& run, const unsigned char* p, size_t size) {
+	benchSimd<Neon>(run, p, size);
+	run("processNeon", size, [&] {
+		Counts c{};
+		KernelState st{};
+		processNeon(p, size, c, st, true, true, true, true, false);
+		gSink = c.lineCount + c.wordCount + c.charCount + c.byteCount;
+	});
+}
+
+const BenchIsa* neonBench() {
+	static const BenchIsa b = { "neon", neonKernel()->supported, bench };
+	return &b;
+}
+#else
+const BenchIsa* neonBench() { return nullptr; }
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "../fastawc/dispatch.h"
+#include "microbench.h"
+
+// The mask and block kernels of one fixed-width ISA, as "<isa>/<kernel>".
+template <class V>
+static void benchSimd(const BenchRun& run, const unsigned char* p, size_t size) {
+	auto name = [](const char* kernel) { return std::string(V::kName) + "/" + kernel; };
+	run(name("maskWhitespace"), size, [&] {
+		uint64_t acc = 0;
+		for (size_t i = 0; i < size; i += V::kWidth)
+			acc += popcnt64(maskWhitespace<V>(V::load(p + i)));
+		gSink = acc;
+	});
+	run(name("maskNewlines"), size, [&] {
+		uint64_t acc = 0;
+		for (size_t i = 0; i < size; i += V::kWidth)
+			acc += popcnt64(maskNewlines<V>(V::load(p + i)));
+		gSink = acc;
+	});
+	run(name("maskUtf8Lead"), size, [&] {
+		uint64_t acc = 0;
+		for (size_t i = 0; i < size; i += V::kWidth)
+			acc += popcnt64(maskUtf8Lead<V>(V::load(p + i)));
+		gSink = acc;
+	});
+	run(name("processBlock"), size, [&] {
+		Counts c{};
+		KernelState st{};
+		for (size_t i = 0; i < size; i += V::kWidth)
+			processBlock<V>(V::load(p + i), c, st,
+				true, true, true, true, false);
+		gSink = c.lineCount + c.wordCount + c.charCount + c.byteCount;
+	});
+	run(name("processTail"), size / V::kWidth * (V::kWidth - 1), [&] {
+		Counts c{};
+		KernelState st{};
+		for (size_t i = 0; i < size; i += V::kWidth)
+			processTail<V>(p + i, V::kWidth - 1, c, st, true, true, true, true, false);
+		gSink = c.lineCount + c.wordCount + c.charCount + c.byteCount;
+	});
+	run(name("processSimd-L"), size, [&] {
+		Counts c{};
+		KernelState st{};
+		processSimd<V>(p, size, c, st, true, true, true, true, true);
+		finalizeScalar(c, st, true);
+		gSink = c.maxLineLength;
+	});
+	// The same bytes as kMaxStreams small files, one after another and
+	// interleaved.
+	size_t part = size / kMaxStreams;
+	run(name("processSimd/files"), part * kMaxStreams, [&] {
+		uint64_t acc = 0;
+		for (size_t s = 0; s < kMaxStreams; ++s) {
+			Counts c{};
+			KernelState st{};
+			processSimd<V>(p + s * part, part, c, st, true, true, true, true, false);
+			acc += c.lineCount + c.wordCount + c.charCount + c.byteCount;
+		}
+		gSink = acc;
+	});
+	run(name("processStreams"), part * kMaxStreams, [&] {
+		const unsigned char* bufs[kMaxStreams];
+		size_t ns[kMaxStreams];
+		Counts c[kMaxStreams];
+		KernelState st[kMaxStreams];
+		for (size_t s = 0; s < kMaxStreams; ++s) {
+			bufs[s] = p + s * part;
+			ns[s] = part;
+		}
+		processStreams<V>(bufs, ns, kMaxStreams, c, st, true, true, true, true, false);
+		uint64_t acc = 0;
+		for (size_t s = 0; s < kMaxStreams; ++s)
+			acc += c[s].lineCount + c[s].wordCount + c[s].charCount + c[s].byteCount;
+		gSink = acc;
+	});
+}
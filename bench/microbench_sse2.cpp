@@ -0,0 +1,14 @@
+#include "microbench_simd.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+static void bench(const BenchRun& run, const unsigned char* p, size_t size) {
+	benchSimd<Sse2>(run, p, size);
+}
+
+const BenchIsa* sse2Bench() {
+	static const BenchIsa b = { "sse2", sse2Kernel()->supported, bench };
+	return &b;
+}
+#else
+const BenchIsa* sse2Bench() { return nullptr; }
+#endif
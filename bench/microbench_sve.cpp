@@ -0,0 +1,26 @@
+#include "microbench_simd.h"
+
+#ifdef __ARM_FEATURE_SVE
+static void bench(const BenchRun& run, const unsigned char* p, size_t size) {
+	run("processSve", size, [&] {
+		Counts c{};
+		KernelState st{};
+		processSve(p, size, c, st, true, true, true, true, false);
+		gSink = c.lineCount + c.wordCount + c.charCount + c.byteCount;
+	});
+	run("processSve-L", size, [&] {
+		Counts c{};
+		KernelState st{};
+		processSve(p, size, c, st, true, true, true, true, true);
+		finalizeScalar(c, st, true);
+		gSink = c.maxLineLength;
+	});
+}
+
+const BenchIsa* sveBench() {
+	static const BenchIsa b = { "sve", sveKernel()->supported, bench };
+	return &b;
+}
+#else
+const BenchIsa* sveBench() { return nullptr; }
+#endif
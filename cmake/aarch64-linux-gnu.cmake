@@ -0,0 +1,19 @@
+# Cross build for 64-bit ARM Linux with the GNU toolchain, tests run under
+# qemu-user:
+#   cmake -S . -B build-arm64 -DCMAKE_TOOLCHAIN_FILE=cmake/aarch64-linux-gnu.cmake
+#   cmake --build build-arm64 && ctest --test-dir build-arm64
+# Needs g++-aarch64-linux-gnu and qemu-user (Debian/Ubuntu package names).
+set(CMAKE_SYSTEM_NAME Linux)
+set(CMAKE_SYSTEM_PROCESSOR aarch64)
+
+set(FASTAWC_CROSS_PREFIX aarch64-linux-gnu- CACHE STRING "Prefix of the cross compiler")
+set(FASTAWC_CROSS_SYSROOT /usr/aarch64-linux-gnu CACHE PATH "Target libraries for qemu")
+set(CMAKE_CXX_COMPILER ${FASTAWC_CROSS_PREFIX}g++)
+
+set(CMAKE_FIND_ROOT_PATH ${FASTAWC_CROSS_SYSROOT})
+set(CMAKE_FIND_ROOT_PATH_MODE_PROGRAM NEVER)
+set(CMAKE_FIND_ROOT_PATH_MODE_LIBRARY ONLY)
+set(CMAKE_FIND_ROOT_PATH_MODE_INCLUDE ONLY)
+set(CMAKE_FIND_ROOT_PATH_MODE_PACKAGE ONLY)
+
+set(CMAKE_CROSSCOMPILING_EMULATOR qemu-aarch64 -L ${FASTAWC_CROSS_SYSROOT})
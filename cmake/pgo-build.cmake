@@ -0,0 +1,57 @@
+# Full profile-guided build, driven by the `pgo` target:
+#   1. build an instrumented fastawc in ${BINARY_DIR}/pgo-build
+#   2. run it over the training workload (pgo-train.cmake)
+#   3. reconfigure the same tree with the collected profile and rebuild
+#      (GCC finds .gcda files by object path, so the tree must not move)
+#   4. with BOLT=ON, instrument that binary with llvm-bolt, rerun the
+#      workload and relayout the binary from the recorded profile
+# The result is copied to ${BINARY_DIR}/fastawc-pgo.
+set(tree ${BINARY_DIR}/pgo-build)
+set(profiles ${tree}/profiles)
+set(link_flags "")
+if(BOLT)
+	set(link_flags -Wl,--emit-relocs)
+endif()
+set(common -G ${GENERATOR} -DCMAKE_BUILD_TYPE=Release -DCMAKE_CXX_COMPILER=${CXX}
+	-DCMAKE_EXE_LINKER_FLAGS=${link_flags}
+	-DFASTAWC_LTO=${LTO} -DFASTAWC_MARCH=${MARCH} -DFASTAWC_AVX2_MARCH=${AVX2_MARCH})
+
+function(run)
+	execute_process(COMMAND ${ARGN} COMMAND_ERROR_IS_FATAL ANY)
+endfunction()
+
+function(train binary profile_dir)
+	run(${CMAKE_COMMAND} -DFASTAWC=${binary} -DGENCORPUS=${tree}/gencorpus
+		-DWORK_DIR=${BINARY_DIR}/pgo-corpus -DPGO_DIR=${profile_dir}
+		-DLLVM_PROFDATA=${LLVM_PROFDATA} -DFLAG_SETS=${FLAG_SETS} -DCORPUS_SIZE=${CORPUS_SIZE}
+		-P ${SOURCE_DIR}/cmake/pgo-train.cmake)
+endfunction()
+
+file(REMOVE_RECURSE ${profiles})
+run(${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${tree} ${common}
+	-DFASTAWC_PGO=GENERATE -DFASTAWC_PGO_DIR=${profiles})
+run(${CMAKE_COMMAND} --build ${tree} --target fastawc gencorpus)
+train(${tree}/fastawc ${profiles})
+
+run(${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${tree} ${common}
+	-DFASTAWC_PGO=USE -DFASTAWC_PGO_DIR=${profiles})
+run(${CMAKE_COMMAND} --build ${tree} --target fastawc)
+set(result ${tree}/fastawc)
+
+if(BOLT)
+	if(NOT LLVM_BOLT)
+		message(FATAL_ERROR "FASTAWC_BOLT=ON but llvm-bolt was not found")
+	endif()
+	set(fdata ${tree}/bolt.fdata)
+	file(REMOVE ${fdata})
+	run(${LLVM_BOLT} ${tree}/fastawc -instrument -instrumentation-file=${fdata}
+		-instrumentation-file-append-pid=0 -o ${tree}/fastawc.bolt-inst)
+	train(${tree}/fastawc.bolt-inst ${tree}/bolt-unused)
+	run(${LLVM_BOLT} ${tree}/fastawc -data=${fdata} -o ${tree}/fastawc.bolt
+		-reorder-blocks=ext-tsp -reorder-functions=hfsort -split-functions
+		-split-all-cold -dyno-stats)
+	set(result ${tree}/fastawc.bolt)
+endif()
+
+file(COPY_FILE ${result} ${BINARY_DIR}/fastawc-pgo)
+message(STATUS "Profile-optimized binary: ${BINARY_DIR}/fastawc-pgo")
@@ -0,0 +1,58 @@
+# Runs an instrumented fastawc over generated corpora so the compiler sees
+# the production mix of inputs and flags. Invoked by the pgo-train target
+# and by pgo-build.cmake (also for the BOLT training run).
+#   FLAG_SETS    comma separated flag sets, repeat one to weight it
+#   CORPUS_SIZE  size of each generated corpus (gencorpus --size)
+if(NOT FLAG_SETS)
+	set(FLAG_SETS "-l,-l,-l,-lw,-lw,-lwm,-lwc,-L")
+endif()
+string(REPLACE "," ";" FLAG_SETS "${FLAG_SETS}")
+if(NOT CORPUS_SIZE)
+	set(CORPUS_SIZE 64M)
+endif()
+file(MAKE_DIRECTORY ${WORK_DIR} ${WORK_DIR}/small ${PGO_DIR})
+
+set(corpora
+	"ascii|--script=ascii|--line-len=uniform:40:120"
+	"utf8|--script=ascii:2,cyrillic:3,cjk:2,emoji:1|--line-len=uniform:40:120"
+	"short|--line-len=uniform:0:4"
+	"long|--line-len=uniform:262144:1048576"
+	"space|--space=0.8")
+foreach(spec ${corpora})
+	string(REPLACE "|" ";" args "${spec}")
+	list(POP_FRONT args name)
+	set(path ${WORK_DIR}/${name}.txt)
+	if(NOT EXISTS ${path})
+		execute_process(COMMAND ${GENCORPUS} --size=${CORPUS_SIZE} --seed=1 --output=${path} ${args}
+			COMMAND_ERROR_IS_FATAL ANY)
+	endif()
+	foreach(flags ${FLAG_SETS})
+		execute_process(COMMAND ${FASTAWC} ${flags} ${path} OUTPUT_QUIET COMMAND_ERROR_IS_FATAL ANY)
+	endforeach()
+	execute_process(COMMAND ${FASTAWC} -lw INPUT_FILE ${path} OUTPUT_QUIET COMMAND_ERROR_IS_FATAL ANY)
+endforeach()
+
+# Many small files in one run exercise per-file setup and the tail path.
+set(small)
+foreach(i RANGE 1 200)
+	set(path ${WORK_DIR}/small/${i}.txt)
+	if(NOT EXISTS ${path})
+		math(EXPR seed "${i} + 1000")
+		execute_process(COMMAND ${GENCORPUS} --size=${i}K --seed=${seed} --output=${path}
+			COMMAND_ERROR_IS_FATAL ANY)
+	endif()
+	list(APPEND small ${path})
+endforeach()
+foreach(flags -l -lw -lwm)
+	execute_process(COMMAND ${FASTAWC} ${flags} ${small} OUTPUT_QUIET COMMAND_ERROR_IS_FATAL ANY)
+endforeach()
+
+file(GLOB raw ${PGO_DIR}/*.profraw)
+if(raw)
+	if(NOT LLVM_PROFDATA)
+		message(FATAL_ERROR "llvm-profdata not found; cannot merge Clang profiles")
+	endif()
+	execute_process(COMMAND ${LLVM_PROFDATA} merge -o ${PGO_DIR}/fastawc.profdata ${raw}
+		COMMAND_ERROR_IS_FATAL ANY)
+endif()
+message(STATUS "Profile written to ${PGO_DIR}")
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "count.h"
+
+// Called for every counted member with its label ("archive:member").
+using MemberFn = std::function<void(const std::string& label, FileResult& r)>;
+
+// Counts the regular members of the tar stream in f (ustar, GNU and pax
+// headers; plain, gzip or zstd compressed) without extracting them: payload
+// is decoded into buffer and counted in place, headers and padding are
+// skipped. Returns an error message, empty on success.
+std::string countTar(FILE* f, const std::string& label, const KernelInfo& k,
+	std::vector<unsigned char>& buffer, const Options& opt, PerfCounters* perf, const MemberFn& emit);
+
+// Under --max-memory, the largest zstd window countTar decodes: the largest
+// power of two within a quarter of the budget, from 1 MiB to 128 MiB. 0
+// (zstd's own limit) otherwise.
+size_t tarZstdWindow(const Options& opt);
+// What countTar allocates besides buffer: its decoder and extended headers.
+size_t tarExtraBytes(const Options& opt);
+
+// Counts the stored and deflated members of the zip archive at path (a
+// seekable file; zip64 included) on opt.threads workers, each with its own
+// file handle and buffer, reading members straight from their offsets in
+// the central directory. emit is called on the calling thread in directory
+// order; members that cannot be counted (encrypted, other methods, corrupt)
+// are reported on stderr and skipped. Returns an error message for the
+// archive as a whole (including how many members were skipped), empty on
+// success.
+std::string countZip(const std::string& path, const KernelInfo& k, const Options& opt, const MemberFn& emit);
+// What each countZip worker allocates besides its read buffer.
+size_t zipWorkerExtraBytes();
@@ -0,0 +1,510 @@
+#include "checksum.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "dispatch.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FASTAWC_XXH3_SSE2 1
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+uint32_t read32(const unsigned char* p) {
+	uint32_t v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+uint64_t read64(const unsigned char* p) {
+	uint64_t v;
+	memcpy(&v, p, 8);
+	return v;
+}
+
+uint64_t swap64(uint64_t v) {
+#if defined(__GNUC__)
+	return __builtin_bswap64(v);
+#elif defined(_MSC_VER)
+	return _byteswap_uint64(v);
+#else
+	v = ((v & 0x00FF00FF00FF00FFull) << 8) | ((v >> 8) & 0x00FF00FF00FF00FFull);
+	v = ((v & 0x0000FFFF0000FFFFull) << 16) | ((v >> 16) & 0x0000FFFF0000FFFFull);
+	return (v << 32) | (v >> 32);
+#endif
+}
+
+// --- CRC-32C (Castagnoli), reflected ---
+
+constexpr uint32_t kCrc32cPoly = 0x82F63B78;
+
+// Slicing-by-8: t[s][b] is the CRC of byte b followed by s zero bytes.
+struct Crc32cTables {
+	uint32_t t[8][256];
+	Crc32cTables() {
+		for (uint32_t b = 0; b < 256; ++b) {
+			uint32_t c = b;
+			for (int k = 0; k < 8; ++k) c = (c >> 1) ^ (kCrc32cPoly & (0u - (c & 1)));
+			t[0][b] = c;
+		}
+		for (int s = 1; s < 8; ++s)
+			for (uint32_t b = 0; b < 256; ++b) t[s][b] = (t[s - 1][b] >> 8) ^ t[0][t[s - 1][b] & 0xFF];
+	}
+};
+
+uint32_t crc32cPortable(uint32_t crc, const unsigned char* p, size_t n) {
+	static const Crc32cTables tables;
+	const auto& t = tables.t;
+	for (; n >= 8; p += 8, n -= 8) {
+		uint64_t v = read64(p) ^ crc;
+		crc = t[7][v & 0xFF] ^ t[6][(v >> 8) & 0xFF] ^ t[5][(v >> 16) & 0xFF] ^ t[4][(v >> 24) & 0xFF]
+			^ t[3][(v >> 32) & 0xFF] ^ t[2][(v >> 40) & 0xFF] ^ t[1][(v >> 48) & 0xFF] ^ t[0][v >> 56];
+	}
+	for (; n > 0; --n) crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+	return crc;
+}
+
+Crc32cFn crc32c() {
+	static const Crc32cFn fn = crc32cSse42() && cpuHasSse42() ? crc32cSse42() : crc32cPortable;
+	return fn;
+}
+
+// --- XXH3-64, seed 0, default secret ---
+
+constexpr uint64_t kPrime32_1 = 0x9E3779B1u;
+constexpr uint64_t kPrime32_2 = 0x85EBCA77u;
+constexpr uint64_t kPrime32_3 = 0xC2B2AE3Du;
+constexpr uint64_t kPrime64_1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t kPrime64_2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t kPrime64_3 = 0x165667B19E3779F9ull;
+constexpr uint64_t kPrime64_4 = 0x85EBCA77C2B2AE63ull;
+constexpr uint64_t kPrime64_5 = 0x27D4EB2F165667C5ull;
+constexpr uint64_t kPrimeMx1 = 0x165667919E3779F9ull;
+constexpr uint64_t kPrimeMx2 = 0x9FB21C651E98DF25ull;
+
+constexpr size_t kStripe = 64;
+constexpr size_t kSecretSize = 192;
+constexpr size_t kStripesPerBlock = (kSecretSize - kStripe) / 8;
+constexpr size_t kXxhBuffer = 256;
+
+alignas(64) const unsigned char kSecret[kSecretSize] = {
+	0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+	0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+	0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+	0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+	0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+	0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+	0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+	0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+	0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+	0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+	0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+	0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+uint64_t mulFold64(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+	unsigned __int128 p = (unsigned __int128)a * b;
+	return (uint64_t)p ^ (uint64_t)(p >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	uint64_t hi;
+	uint64_t lo = _umul128(a, b, &hi);
+	return lo ^ hi;
+#else
+	uint64_t ll = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF), hl = (a >> 32) * (b & 0xFFFFFFFF);
+	uint64_t lh = (a & 0xFFFFFFFF) * (b >> 32), hh = (a >> 32) * (b >> 32);
+	uint64_t cross = (ll >> 32) + (hl & 0xFFFFFFFF) + lh;
+	return ((cross << 32) | (ll & 0xFFFFFFFF)) ^ ((hl >> 32) + (cross >> 32) + hh);
+#endif
+}
+
+uint64_t xxh64Avalanche(uint64_t h) {
+	h ^= h >> 33;
+	h *= kPrime64_2;
+	h ^= h >> 29;
+	h *= kPrime64_3;
+	return h ^ (h >> 32);
+}
+
+uint64_t xxh3Avalanche(uint64_t h) {
+	h ^= h >> 37;
+	h *= kPrimeMx1;
+	return h ^ (h >> 32);
+}
+
+uint64_t rrmxmx(uint64_t h, uint64_t len) {
+	h ^= ((h << 49) | (h >> 15)) ^ ((h << 24) | (h >> 40));
+	h *= kPrimeMx2;
+	h ^= (h >> 35) + len;
+	h *= kPrimeMx2;
+	return h ^ (h >> 28);
+}
+
+uint64_t mix16(const unsigned char* p, const unsigned char* secret) {
+	return mulFold64(read64(p) ^ read64(secret), read64(p + 8) ^ read64(secret + 8));
+}
+
+// Inputs of at most 240 bytes are hashed whole.
+uint64_t xxh3Short(const unsigned char* p, size_t len) {
+	const unsigned char* s = kSecret;
+	if (len == 0) return xxh64Avalanche(read64(s + 56) ^ read64(s + 64));
+	if (len <= 3) {
+		uint32_t combined = ((uint32_t)p[0] << 16) | ((uint32_t)p[len >> 1] << 24) | p[len - 1] | ((uint32_t)len << 8);
+		return xxh64Avalanche(combined ^ (uint64_t)(read32(s) ^ read32(s + 4)));
+	}
+	if (len <= 8) {
+		uint64_t v = read32(p + len - 4) + ((uint64_t)read32(p) << 32);
+		return rrmxmx(v ^ (read64(s + 8) ^ read64(s + 16)), len);
+	}
+	if (len <= 16) {
+		uint64_t lo = read64(p) ^ (read64(s + 24) ^ read64(s + 32));
+		uint64_t hi = read64(p + len - 8) ^ (read64(s + 40) ^ read64(s + 48));
+		return xxh3Avalanche(len + swap64(lo) + hi + mulFold64(lo, hi));
+	}
+	uint64_t acc = len * kPrime64_1;
+	if (len <= 128) {
+		if (len > 32) {
+			if (len > 64) {
+				if (len > 96) acc += mix16(p + 48, s + 96) + mix16(p + len - 64, s + 112);
+				acc += mix16(p + 32, s + 64) + mix16(p + len - 48, s + 80);
+			}
+			acc += mix16(p + 16, s + 32) + mix16(p + len - 32, s + 48);
+		}
+		acc += mix16(p, s) + mix16(p + len - 16, s + 16);
+		return xxh3Avalanche(acc);
+	}
+	for (size_t i = 0; i < 8; ++i) acc += mix16(p + 16 * i, s + 16 * i);
+	acc = xxh3Avalanche(acc);
+	for (size_t i = 8; i < len / 16; ++i) acc += mix16(p + 16 * i, s + 16 * (i - 8) + 3);
+	acc += mix16(p + len - 16, s + 136 - 17);
+	return xxh3Avalanche(acc);
+}
+
+void xxh3Accumulate(uint64_t* acc, const unsigned char* p, const unsigned char* secret, size_t stripes) {
+	for (; stripes > 0; --stripes, p += kStripe, secret += 8) {
+#ifdef FASTAWC_XXH3_SSE2
+		__m128i* x = (__m128i*)acc;
+		for (int i = 0; i < 4; ++i) {
+			__m128i data = _mm_loadu_si128((const __m128i*)(p + 16 * i));
+			__m128i key = _mm_xor_si128(data, _mm_loadu_si128((const __m128i*)(secret + 16 * i)));
+			__m128i product = _mm_mul_epu32(key, _mm_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+			__m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+			x[i] = _mm_add_epi64(x[i], _mm_add_epi64(product, swapped));
+		}
+#else
+		for (int i = 0; i < 8; ++i) {
+			uint64_t data = read64(p + 8 * i);
+			uint64_t key = data ^ read64(secret + 8 * i);
+			acc[i ^ 1] += data;
+			acc[i] += (key & 0xFFFFFFFF) * (key >> 32);
+		}
+#endif
+	}
+}
+
+// Accumulates whole stripes, scrambling each time a block of them fills.
+void xxh3Consume(uint64_t* acc, size_t& stripesSoFar, const unsigned char* p, size_t stripes) {
+	while (stripes > 0) {
+		size_t take = std::min(stripes, kStripesPerBlock - stripesSoFar);
+		xxh3Accumulate(acc, p, kSecret + stripesSoFar * 8, take);
+		p += take * kStripe;
+		stripes -= take;
+		stripesSoFar += take;
+		if (stripesSoFar < kStripesPerBlock) continue;
+		const unsigned char* s = kSecret + kSecretSize - kStripe;
+		for (int i = 0; i < 8; ++i) {
+			uint64_t a = acc[i];
+			a ^= a >> 47;
+			a ^= read64(s + 8 * i);
+			acc[i] = a * kPrime32_1;
+		}
+		stripesSoFar = 0;
+	}
+}
+
+// Always holds 1..256 unconsumed bytes once more than 256 have been seen,
+// with the 64 bytes before them at the end of buffer when fewer than 64.
+struct Xxh3 {
+	alignas(16) uint64_t acc[8] = { kPrime32_3, kPrime64_1, kPrime64_2, kPrime64_3, kPrime64_4, kPrime32_2, kPrime64_5, kPrime32_1 };
+	unsigned char buffer[kXxhBuffer];
+	size_t buffered = 0;
+	size_t stripesSoFar = 0;
+	uint64_t total = 0;
+
+	void update(const unsigned char* p, size_t n) {
+		total += n;
+		if (buffered + n <= kXxhBuffer) {
+			memcpy(buffer + buffered, p, n);
+			buffered += n;
+			return;
+		}
+		if (buffered) {
+			size_t fill = kXxhBuffer - buffered;
+			memcpy(buffer + buffered, p, fill);
+			p += fill;
+			n -= fill;
+			xxh3Consume(acc, stripesSoFar, buffer, kXxhBuffer / kStripe);
+			buffered = 0;
+		}
+		if (n > kXxhBuffer) {
+			size_t stripes = (n - 1) / kStripe;
+			xxh3Consume(acc, stripesSoFar, p, stripes);
+			p += stripes * kStripe;
+			n -= stripes * kStripe;
+			memcpy(buffer + kXxhBuffer - kStripe, p - kStripe, kStripe);
+		}
+		memcpy(buffer, p, n);
+		buffered = n;
+	}
+
+	uint64_t digest() const {
+		if (total <= 240) return xxh3Short(buffer, (size_t)total);
+		alignas(16) uint64_t a[8];
+		memcpy(a, acc, sizeof(a));
+		unsigned char last[kStripe];
+		if (buffered >= kStripe) {
+			size_t soFar = stripesSoFar;
+			xxh3Consume(a, soFar, buffer, (buffered - 1) / kStripe);
+			memcpy(last, buffer + buffered - kStripe, kStripe);
+		}
+		else {
+			size_t before = kStripe - buffered;
+			memcpy(last, buffer + kXxhBuffer - before, before);
+			memcpy(last + before, buffer, buffered);
+		}
+		xxh3Accumulate(a, last, kSecret + kSecretSize - kStripe - 7, 1);
+		uint64_t h = total * kPrime64_1;
+		for (int i = 0; i < 4; ++i)
+			h += mulFold64(a[2 * i] ^ read64(kSecret + 11 + 16 * i), a[2 * i + 1] ^ read64(kSecret + 11 + 16 * i + 8));
+		return xxh3Avalanche(h);
+	}
+};
+
+// --- BLAKE3, unkeyed, 256-bit output ---
+
+constexpr uint32_t kBlake3Iv[8] = {
+	0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+};
+constexpr unsigned char kMsgPermutation[16] = { 2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8 };
+constexpr uint32_t kChunkStart = 1, kChunkEnd = 2, kParent = 4, kRoot = 8;
+constexpr size_t kBlockLen = 64;
+constexpr size_t kChunkLen = 1024;
+constexpr size_t kMaxDepth = 54;
+
+uint32_t rotr32(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+void g(uint32_t* s, int a, int b, int c, int d, uint32_t mx, uint32_t my) {
+	s[a] = s[a] + s[b] + mx;
+	s[d] = rotr32(s[d] ^ s[a], 16);
+	s[c] = s[c] + s[d];
+	s[b] = rotr32(s[b] ^ s[c], 12);
+	s[a] = s[a] + s[b] + my;
+	s[d] = rotr32(s[d] ^ s[a], 8);
+	s[c] = s[c] + s[d];
+	s[b] = rotr32(s[b] ^ s[c], 7);
+}
+
+void blake3Compress(const uint32_t cv[8], const uint32_t block[16], uint64_t counter,
+	uint32_t blockLen, uint32_t flags, uint32_t out[16])
+{
+	uint32_t s[16] = { cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+		kBlake3Iv[0], kBlake3Iv[1], kBlake3Iv[2], kBlake3Iv[3],
+		(uint32_t)counter, (uint32_t)(counter >> 32), blockLen, flags };
+	uint32_t m[16], t[16];
+	memcpy(m, block, sizeof(m));
+	for (int r = 0; r < 7; ++r) {
+		g(s, 0, 4, 8, 12, m[0], m[1]);
+		g(s, 1, 5, 9, 13, m[2], m[3]);
+		g(s, 2, 6, 10, 14, m[4], m[5]);
+		g(s, 3, 7, 11, 15, m[6], m[7]);
+		g(s, 0, 5, 10, 15, m[8], m[9]);
+		g(s, 1, 6, 11, 12, m[10], m[11]);
+		g(s, 2, 7, 8, 13, m[12], m[13]);
+		g(s, 3, 4, 9, 14, m[14], m[15]);
+		for (int i = 0; i < 16; ++i) t[i] = m[kMsgPermutation[i]];
+		memcpy(m, t, sizeof(m));
+	}
+	for (int i = 0; i < 8; ++i) {
+		out[i] = s[i] ^ s[i + 8];
+		out[i + 8] = s[i + 8] ^ cv[i];
+	}
+}
+
+void blockWords(const unsigned char* p, uint32_t words[16]) {
+	for (int i = 0; i < 16; ++i) words[i] = read32(p + 4 * i);
+}
+
+Blake3ChunksFn blake3Chunks() {
+	static const Blake3ChunksFn fn = blake3ChunksAvx2() && cpuHasAvx2() ? blake3ChunksAvx2() : nullptr;
+	return fn;
+}
+
+// The chunk being filled plus the stack of subtree chaining values to its
+// left; a chunk is only closed once input beyond it arrives, since the last
+// one is finalized differently.
+struct Blake3 {
+	uint32_t cv[8];
+	uint64_t chunk = 0;
+	unsigned char block[kBlockLen];
+	size_t blockLen = 0;
+	size_t blocksDone = 0;
+	uint32_t stack[kMaxDepth][8];
+	size_t depth = 0;
+
+	Blake3() { memcpy(cv, kBlake3Iv, sizeof(cv)); }
+
+	size_t chunkLen() const { return blocksDone * kBlockLen + blockLen; }
+	uint32_t startFlag() const { return blocksDone == 0 ? kChunkStart : 0; }
+
+	void startChunk(uint64_t counter) {
+		memcpy(cv, kBlake3Iv, sizeof(cv));
+		chunk = counter;
+		blockLen = blocksDone = 0;
+	}
+
+	// Merges completed subtrees: as many as trailing zero bits in totalChunks.
+	void pushChunk(const uint32_t chunkCv[8], uint64_t totalChunks) {
+		uint32_t node[8], block16[16], out[16];
+		memcpy(node, chunkCv, sizeof(node));
+		for (; (totalChunks & 1) == 0; totalChunks >>= 1) {
+			memcpy(block16, stack[--depth], 32);
+			memcpy(block16 + 8, node, 32);
+			blake3Compress(kBlake3Iv, block16, 0, kBlockLen, kParent, out);
+			memcpy(node, out, sizeof(node));
+		}
+		memcpy(stack[depth++], node, sizeof(node));
+	}
+
+	void update(const unsigned char* p, size_t n) {
+		uint32_t words[16], out[16];
+		while (n > 0) {
+			if (chunkLen() == kChunkLen) {
+				blockWords(block, words);
+				blake3Compress(cv, words, chunk, kBlockLen, kChunkEnd | startFlag(), out);
+				pushChunk(out, chunk + 1);
+				startChunk(chunk + 1);
+			}
+			Blake3ChunksFn many = blake3Chunks();
+			if (many && chunkLen() == 0 && n > 8 * kChunkLen) {
+				uint32_t cvs[8 * 8];
+				for (size_t groups = (n - 1) / (8 * kChunkLen); groups > 0; --groups) {
+					many(p, 8, chunk, cvs);
+					for (int i = 0; i < 8; ++i) pushChunk(cvs + 8 * i, chunk + i + 1);
+					startChunk(chunk + 8);
+					p += 8 * kChunkLen;
+					n -= 8 * kChunkLen;
+				}
+			}
+			if (blockLen == kBlockLen) {
+				blockWords(block, words);
+				blake3Compress(cv, words, chunk, kBlockLen, startFlag(), out);
+				memcpy(cv, out, sizeof(cv));
+				blocksDone++;
+				blockLen = 0;
+			}
+			size_t take = std::min(kBlockLen - blockLen, n);
+			memcpy(block + blockLen, p, take);
+			blockLen += take;
+			p += take;
+			n -= take;
+		}
+	}
+
+	void digest(unsigned char hash[32]) const {
+		uint32_t inCv[8], words[16], out[16];
+		memcpy(inCv, cv, sizeof(inCv));
+		unsigned char last[kBlockLen] = {};
+		memcpy(last, block, blockLen);
+		blockWords(last, words);
+		uint64_t counter = chunk;
+		uint32_t len = (uint32_t)blockLen;
+		uint32_t flags = kChunkEnd | startFlag();
+		for (size_t i = depth; i-- > 0;) {
+			blake3Compress(inCv, words, counter, len, flags, out);
+			memcpy(words, stack[i], 32);
+			memcpy(words + 8, out, 32);
+			memcpy(inCv, kBlake3Iv, sizeof(inCv));
+			counter = 0;
+			len = kBlockLen;
+			flags = kParent;
+		}
+		blake3Compress(inCv, words, counter, len, flags | kRoot, out);
+		for (int i = 0; i < 8; ++i)
+			for (int b = 0; b < 4; ++b) hash[4 * i + b] = (unsigned char)(out[i] >> (8 * b));
+	}
+};
+
+} // namespace
+
+struct Checksum::State {
+	uint32_t crc = 0xFFFFFFFF;
+	Xxh3 xxh3;
+	Blake3 blake3;
+};
+
+Checksum::Checksum(Algorithm algorithm)
+	: algorithm_(algorithm), state_(algorithm == kNone ? nullptr : new State)
+{
+}
+
+Checksum::~Checksum() = default;
+Checksum::Checksum(Checksum&&) noexcept = default;
+Checksum& Checksum::operator=(Checksum&&) noexcept = default;
+
+void Checksum::update(const unsigned char* p, size_t n) {
+	switch (algorithm_) {
+	case kCrc32c: state_->crc = crc32c()(state_->crc, p, n); break;
+	case kXxh3:   state_->xxh3.update(p, n); break;
+	case kBlake3: state_->blake3.update(p, n); break;
+	case kNone:   break;
+	}
+}
+
+void Checksum::updateZeros(uint64_t n) {
+	static const unsigned char zeros[64 << 10] = {};
+	for (; n > 0 && algorithm_ != kNone; n -= std::min<uint64_t>(n, sizeof(zeros)))
+		update(zeros, (size_t)std::min<uint64_t>(n, sizeof(zeros)));
+}
+
+std::string Checksum::hex() const {
+	unsigned char digest[32];
+	size_t len = 0;
+	switch (algorithm_) {
+	case kCrc32c:
+		for (int i = 0; i < 4; ++i) digest[i] = (unsigned char)(~state_->crc >> (24 - 8 * i));
+		len = 4;
+		break;
+	case kXxh3: {
+		uint64_t h = state_->xxh3.digest();
+		for (int i = 0; i < 8; ++i) digest[i] = (unsigned char)(h >> (56 - 8 * i));
+		len = 8;
+		break;
+	}
+	case kBlake3:
+		state_->blake3.digest(digest);
+		len = 32;
+		break;
+	case kNone:
+		break;
+	}
+	static const char kHex[] = "0123456789abcdef";
+	std::string s;
+	for (size_t i = 0; i < len; ++i) {
+		s += kHex[digest[i] >> 4];
+		s += kHex[digest[i] & 15];
+	}
+	return s;
+}
+
+bool Checksum::parse(const std::string& name, Algorithm& algorithm) {
+	if (name == "crc32c") algorithm = kCrc32c;
+	else if (name == "xxh3") algorithm = kXxh3;
+	else if (name == "blake3") algorithm = kBlake3;
+	else return false;
+	return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Streaming digest computed over the same buffers as the counters
+// (--checksum): CRC-32C, XXH3-64 (seed 0) or BLAKE3-256. The CRC uses the
+// SSE4.2 crc32 instruction when the CPU has it and BLAKE3 hashes eight
+// chunks at a time with AVX2; both fall back to portable code.
+class Checksum {
+public:
+	enum Algorithm { kNone, kCrc32c, kXxh3, kBlake3 };
+
+	explicit Checksum(Algorithm algorithm);
+	~Checksum();
+	Checksum(Checksum&&) noexcept;
+	Checksum& operator=(Checksum&&) noexcept;
+
+	void update(const unsigned char* p, size_t n);
+	// n zero bytes, for holes in sparse files.
+	void updateZeros(uint64_t n);
+	// Lower-case hex of the digest of everything so far; more may follow.
+	std::string hex() const;
+
+	Algorithm algorithm() const { return algorithm_; }
+	static bool parse(const std::string& name, Algorithm& algorithm);
+
+private:
+	struct State;
+	Algorithm algorithm_;
+	std::unique_ptr<State> state_;
+};
+
+// Per-ISA helpers, each nullptr when its translation unit was not built for
+// that instruction set. Both work on raw values: the CRC register without
+// the initial and final inversion, and the chaining values of `chunks` (a
+// multiple of eight) whole 1 KiB BLAKE3 chunks numbered from counter, eight
+// words each.
+using Crc32cFn = uint32_t (*)(uint32_t crc, const unsigned char* p, size_t n);
+using Blake3ChunksFn = void (*)(const unsigned char* input, size_t chunks, uint64_t counter, uint32_t* cvs);
+Crc32cFn crc32cSse42();
+Blake3ChunksFn blake3ChunksAvx2();
@@ -0,0 +1,131 @@
+#include "checksum.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+
+// The rounds must inline for the message indices to become constants.
+#ifdef _MSC_VER
+#define FASTAWC_INLINE __forceinline
+#else
+#define FASTAWC_INLINE inline __attribute__((always_inline))
+#endif
+
+namespace {
+
+constexpr uint32_t kBlake3Iv[8] = {
+	0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+};
+// Message word order of each round: the permutation applied r times.
+constexpr unsigned char kSchedule[7][16] = {
+	{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+	{ 2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8 },
+	{ 3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1 },
+	{ 10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6 },
+	{ 12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4 },
+	{ 9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7 },
+	{ 11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13 },
+};
+constexpr uint32_t kChunkStart = 1, kChunkEnd = 2;
+constexpr size_t kBlockLen = 64;
+constexpr size_t kChunkLen = 1024;
+
+inline __m256i add(__m256i a, __m256i b) { return _mm256_add_epi32(a, b); }
+inline __m256i rotr16(__m256i x) {
+	return _mm256_shuffle_epi8(x, _mm256_set_epi8(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2,
+		13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2));
+}
+inline __m256i rotr8(__m256i x) {
+	return _mm256_shuffle_epi8(x, _mm256_set_epi8(12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1,
+		12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1));
+}
+inline __m256i rotr12(__m256i x) { return _mm256_or_si256(_mm256_srli_epi32(x, 12), _mm256_slli_epi32(x, 20)); }
+inline __m256i rotr7(__m256i x) { return _mm256_or_si256(_mm256_srli_epi32(x, 7), _mm256_slli_epi32(x, 25)); }
+
+FASTAWC_INLINE void g(__m256i* s, int a, int b, int c, int d, __m256i mx, __m256i my) {
+	s[a] = add(add(s[a], s[b]), mx);
+	s[d] = rotr16(_mm256_xor_si256(s[d], s[a]));
+	s[c] = add(s[c], s[d]);
+	s[b] = rotr12(_mm256_xor_si256(s[b], s[c]));
+	s[a] = add(add(s[a], s[b]), my);
+	s[d] = rotr8(_mm256_xor_si256(s[d], s[a]));
+	s[c] = add(s[c], s[d]);
+	s[b] = rotr7(_mm256_xor_si256(s[b], s[c]));
+}
+
+FASTAWC_INLINE void round(__m256i* s, const __m256i* m, const unsigned char* w) {
+	g(s, 0, 4, 8, 12, m[w[0]], m[w[1]]);
+	g(s, 1, 5, 9, 13, m[w[2]], m[w[3]]);
+	g(s, 2, 6, 10, 14, m[w[4]], m[w[5]]);
+	g(s, 3, 7, 11, 15, m[w[6]], m[w[7]]);
+	g(s, 0, 5, 10, 15, m[w[8]], m[w[9]]);
+	g(s, 1, 6, 11, 12, m[w[10]], m[w[11]]);
+	g(s, 2, 7, 8, 13, m[w[12]], m[w[13]]);
+	g(s, 3, 4, 9, 14, m[w[14]], m[w[15]]);
+}
+
+// Rows (one per lane) to columns (one per word), and back.
+void transpose(__m256i v[8]) {
+	__m256i ab0145 = _mm256_unpacklo_epi32(v[0], v[1]), ab2367 = _mm256_unpackhi_epi32(v[0], v[1]);
+	__m256i cd0145 = _mm256_unpacklo_epi32(v[2], v[3]), cd2367 = _mm256_unpackhi_epi32(v[2], v[3]);
+	__m256i ef0145 = _mm256_unpacklo_epi32(v[4], v[5]), ef2367 = _mm256_unpackhi_epi32(v[4], v[5]);
+	__m256i gh0145 = _mm256_unpacklo_epi32(v[6], v[7]), gh2367 = _mm256_unpackhi_epi32(v[6], v[7]);
+	__m256i abcd04 = _mm256_unpacklo_epi64(ab0145, cd0145), abcd15 = _mm256_unpackhi_epi64(ab0145, cd0145);
+	__m256i abcd26 = _mm256_unpacklo_epi64(ab2367, cd2367), abcd37 = _mm256_unpackhi_epi64(ab2367, cd2367);
+	__m256i efgh04 = _mm256_unpacklo_epi64(ef0145, gh0145), efgh15 = _mm256_unpackhi_epi64(ef0145, gh0145);
+	__m256i efgh26 = _mm256_unpacklo_epi64(ef2367, gh2367), efgh37 = _mm256_unpackhi_epi64(ef2367, gh2367);
+	v[0] = _mm256_permute2x128_si256(abcd04, efgh04, 0x20);
+	v[1] = _mm256_permute2x128_si256(abcd15, efgh15, 0x20);
+	v[2] = _mm256_permute2x128_si256(abcd26, efgh26, 0x20);
+	v[3] = _mm256_permute2x128_si256(abcd37, efgh37, 0x20);
+	v[4] = _mm256_permute2x128_si256(abcd04, efgh04, 0x31);
+	v[5] = _mm256_permute2x128_si256(abcd15, efgh15, 0x31);
+	v[6] = _mm256_permute2x128_si256(abcd26, efgh26, 0x31);
+	v[7] = _mm256_permute2x128_si256(abcd37, efgh37, 0x31);
+}
+
+// Eight whole chunks side by side, one per 32-bit lane.
+void hash8(const unsigned char* input, uint64_t counter, uint32_t* cvs) {
+	__m256i cv[8];
+	for (int i = 0; i < 8; ++i) cv[i] = _mm256_set1_epi32((int)kBlake3Iv[i]);
+	__m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256i counterLo = add(_mm256_set1_epi32((int)(uint32_t)counter), lanes);
+	// Carry into the high word where the low word wrapped (unsigned lo < lane).
+	__m256i sign = _mm256_set1_epi32((int)0x80000000);
+	__m256i carry = _mm256_cmpgt_epi32(_mm256_xor_si256(lanes, sign), _mm256_xor_si256(counterLo, sign));
+	__m256i counterHi = _mm256_sub_epi32(_mm256_set1_epi32((int)(uint32_t)(counter >> 32)), carry);
+
+	for (size_t b = 0; b < kChunkLen / kBlockLen; ++b) {
+		__m256i m[16];
+		for (int half = 0; half < 2; ++half) {
+			for (int i = 0; i < 8; ++i)
+				m[8 * half + i] = _mm256_loadu_si256((const __m256i*)(input + i * kChunkLen + b * kBlockLen + 32 * half));
+			transpose(m + 8 * half);
+		}
+		uint32_t flags = (b == 0 ? kChunkStart : 0) | (b + 1 == kChunkLen / kBlockLen ? kChunkEnd : 0);
+		__m256i s[16] = { cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+			_mm256_set1_epi32((int)kBlake3Iv[0]), _mm256_set1_epi32((int)kBlake3Iv[1]),
+			_mm256_set1_epi32((int)kBlake3Iv[2]), _mm256_set1_epi32((int)kBlake3Iv[3]),
+			counterLo, counterHi, _mm256_set1_epi32((int)kBlockLen), _mm256_set1_epi32((int)flags) };
+		round(s, m, kSchedule[0]);
+		round(s, m, kSchedule[1]);
+		round(s, m, kSchedule[2]);
+		round(s, m, kSchedule[3]);
+		round(s, m, kSchedule[4]);
+		round(s, m, kSchedule[5]);
+		round(s, m, kSchedule[6]);
+		for (int i = 0; i < 8; ++i) cv[i] = _mm256_xor_si256(s[i], s[i + 8]);
+	}
+	transpose(cv);
+	for (int i = 0; i < 8; ++i) _mm256_storeu_si256((__m256i*)(cvs + 8 * i), cv[i]);
+}
+
+void blake3Chunks(const unsigned char* input, size_t chunks, uint64_t counter, uint32_t* cvs) {
+	for (size_t c = 0; c < chunks; c += 8) hash8(input + c * kChunkLen, counter + c, cvs + 8 * c);
+}
+
+} // namespace
+
+Blake3ChunksFn blake3ChunksAvx2() { return blake3Chunks; }
+#else
+Blake3ChunksFn blake3ChunksAvx2() { return nullptr; }
+#endif
@@ -0,0 +1,554 @@
+#include "count.h"
+#include "decompress.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#endif
+
+bool parseSize(const std::string& s, uint64_t& bytes) {
+	char* end = nullptr;
+	uint64_t v = strtoull(s.c_str(), &end, 10);
+	if (end == s.c_str()) return false;
+	switch (*end) {
+	case 'k': case 'K': v <<= 10; ++end; break;
+	case 'm': case 'M': v <<= 20; ++end; break;
+	case 'g': case 'G': v <<= 30; ++end; break;
+	}
+	if (*end != '\0') return false;
+	bytes = v;
+	return true;
+}
+
+void applyMemoryBudget(Options& opt, unsigned workers, size_t perWorkerExtra, size_t cacheEntryBytes) {
+	opt.threads = std::max(1u, workers);
+	if (opt.maxMemory == 0) return;
+	uint64_t budget = opt.maxMemory;
+	if (cacheEntryBytes) {
+		opt.cacheEntries = (size_t)std::min<uint64_t>(opt.cacheEntries, budget / 8 / cacheEntryBytes);
+		budget -= opt.cacheEntries * cacheEntryBytes;
+	}
+	uint64_t minWorker = kMinBufSize + perWorkerExtra;
+	if (budget / opt.threads < minWorker)
+		opt.threads = (unsigned)std::max<uint64_t>(1, budget / minWorker);
+	uint64_t perWorker = budget / opt.threads;
+	uint64_t buf = perWorker > perWorkerExtra ? perWorker - perWorkerExtra : 0;
+	buf = std::min<uint64_t>(std::max<uint64_t>(buf, kMinBufSize), kBufSize);
+	opt.bufSize = (size_t)(buf & ~(uint64_t)4095);
+}
+
+void addStats(Stats& total, const Stats& s) {
+	total.openSec += s.openSec;
+	total.readSec += s.readSec;
+	total.kernelSec += s.kernelSec;
+	total.outputSec += s.outputSec;
+	total.bytes += s.bytes;
+	total.reads += s.reads;
+	total.syscalls += s.syscalls;
+}
+
+void addCounts(Counts& total, const Counts& c) {
+	total.lineCount += c.lineCount;
+	total.wordCount += c.wordCount;
+	total.byteCount += c.byteCount;
+	total.charCount += c.charCount;
+	total.maxLineLength = std::max(total.maxLineLength, c.maxLineLength);
+}
+
+std::string formatCounts(const Counts& c, const std::string* label, const Options& opt, const std::string& digest) {
+	std::string s;
+	if (opt.optLines)   s += std::to_string(c.lineCount) + " ";
+	if (opt.optWords)   s += std::to_string(c.wordCount) + " ";
+	if (opt.optBytes)   s += std::to_string(c.byteCount) + " ";
+	if (opt.optChars)   s += std::to_string(c.charCount) + " ";
+	if (opt.optMaxLine) s += std::to_string(c.maxLineLength) + " ";
+	if (!digest.empty()) s += digest + " ";
+	if (label)          s += *label;
+	s += "\n";
+	return s;
+}
+
+FILE* openInput(const std::string& path) {
+	if (path == "-") return stdin;
+	FILE* f = nullptr;
+#ifdef _MSC_VER
+	if (fopen_s(&f, path.c_str(), "rb") != 0) return nullptr;
+#else
+	f = fopen(path.c_str(), "rb");
+#endif
+	return f;
+}
+
+void closeInput(FILE* f) {
+	if (f && f != stdin) fclose(f);
+}
+
+bool regularFileSize(FILE* f, uint64_t& size) {
+#ifdef _MSC_VER
+	struct _stat64 sb;
+	if (_fstat64(_fileno(f), &sb) != 0 || (sb.st_mode & _S_IFMT) != _S_IFREG) return false;
+#else
+	struct stat sb;
+	if (fstat(fileno(f), &sb) != 0 || !S_ISREG(sb.st_mode)) return false;
+#endif
+	size = (uint64_t)sb.st_size;
+	return true;
+}
+
+bool seekInput(FILE* f, uint64_t offset) {
+#ifdef _MSC_VER
+	return _fseeki64(f, (__int64)offset, SEEK_SET) == 0;
+#else
+	return fseeko(f, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+bool tellInput(FILE* f, uint64_t& offset) {
+#ifdef _MSC_VER
+	__int64 pos = _ftelli64(f);
+#else
+	off_t pos = ftello(f);
+#endif
+	if (pos < 0) return false;
+	offset = (uint64_t)pos;
+	return true;
+}
+
+bool isSparse(FILE* f) {
+#ifdef SEEK_HOLE
+	struct stat sb;
+	return fstat(fileno(f), &sb) == 0 && S_ISREG(sb.st_mode) && (uint64_t)sb.st_blocks * 512 < (uint64_t)sb.st_size;
+#else
+	(void)f;
+	return false;
+#endif
+}
+
+Extent nextExtent(FILE* f, uint64_t offset, uint64_t limit) {
+	if (offset >= limit) return Extent{ false, 0 };
+#ifdef SEEK_HOLE
+	int fd = fileno(f);
+	off_t data = lseek(fd, (off_t)offset, SEEK_DATA);
+	if (data < 0) return Extent{ errno == ENXIO, limit - offset };
+	if ((uint64_t)data > offset) return Extent{ true, std::min<uint64_t>((uint64_t)data, limit) - offset };
+	off_t hole = lseek(fd, (off_t)offset, SEEK_HOLE);
+	if (hole < 0) return Extent{ false, limit - offset };
+	return Extent{ false, std::min<uint64_t>((uint64_t)hole, limit) - offset };
+#else
+	(void)f;
+	return Extent{ false, limit - offset };
+#endif
+}
+
+uint64_t rangeEnd(const Options& opt) {
+	return opt.length > UINT64_MAX - opt.offset ? UINT64_MAX : opt.offset + opt.length;
+}
+
+#ifdef __linux__
+constexpr size_t kDeviceReadSize = 16u << 20;
+constexpr size_t kDeviceAlign = 4096;
+
+// Block devices bypass stdio: large page-aligned preads, with O_DIRECT when
+// the device accepts it, so scanning a disk neither copies through the
+// page cache nor evicts everything else from it. -c alone is answered from
+// BLKGETSIZE64 without reading. Under --max-memory the reads go to the
+// aligned part of buffer instead of a 16 MiB block of their own. 1 when f
+// was counted, 0 when it is not a block device (or the block cannot be
+// allocated), -1 on a read error (errno is set).
+static int countBlockDevice(FILE* f, const KernelInfo& k, std::vector<unsigned char>& buffer, const Options& opt,
+	Counts& c, KernelState& st, Stats& stats, PerfCounters* perf, Checksum* sum)
+{
+	int fd = fileno(f);
+	struct stat sb;
+	uint64_t devSize = 0;
+	if (opt.partition || fstat(fd, &sb) != 0 || !S_ISBLK(sb.st_mode) || ioctl(fd, BLKGETSIZE64, &devSize) != 0) return 0;
+	stats.syscalls += 2;
+	uint64_t begin = std::min(opt.offset, devSize), end = std::min(rangeEnd(opt), devSize);
+	if (!opt.optLines && !opt.optWords && !opt.optChars && !opt.optMaxLine && !sum) {
+		c.byteCount = end - begin;
+		return 1;
+	}
+
+	size_t chunk = kDeviceReadSize;
+	void* mem = nullptr;
+	if (opt.maxMemory) {
+		uintptr_t p = (uintptr_t)buffer.data();
+		uintptr_t aligned = (p + kDeviceAlign - 1) & ~(uintptr_t)(kDeviceAlign - 1);
+		chunk = (buffer.size() - (size_t)(aligned - p)) & ~(kDeviceAlign - 1);
+		mem = (void*)aligned;
+	}
+	else if (posix_memalign(&mem, kDeviceAlign, chunk) != 0) {
+		return 0;
+	}
+	std::unique_ptr<void, decltype(&free)> hold(opt.maxMemory ? nullptr : mem, free);
+	unsigned char* buf = (unsigned char*)mem;
+	int flags = fcntl(fd, F_GETFL);
+	bool direct = fcntl(fd, F_SETFL, flags | O_DIRECT) == 0;
+	posix_fadvise(fd, (off_t)begin, (off_t)(end - begin), POSIX_FADV_SEQUENTIAL);
+	stats.syscalls += 4;
+
+	uint64_t pos = begin & ~(uint64_t)(kDeviceAlign - 1);
+	int result = 1;
+	Clock::time_point t1 = Clock::now();
+	while (pos < end) {
+		size_t want = (size_t)std::min<uint64_t>(chunk, (end - pos + kDeviceAlign - 1) & ~(uint64_t)(kDeviceAlign - 1));
+		ssize_t n = pread(fd, buf, want, (off_t)pos);
+		if (n < 0 && errno == EINVAL && direct) {
+			direct = false;
+			fcntl(fd, F_SETFL, flags);
+			continue;
+		}
+		if (n < 0 && errno == EINTR) continue;
+		Clock::time_point t2 = Clock::now();
+		stats.readSec += secondsBetween(t1, t2);
+		stats.reads++;
+		if (n < 0) {
+			result = -1;
+			break;
+		}
+		if (n == 0) break;
+		size_t skip = begin > pos ? (size_t)(begin - pos) : 0;
+		size_t take = (size_t)std::min<uint64_t>((uint64_t)n, end - pos);
+		if (take > skip) {
+			stats.bytes += take - skip;
+			if (perf) perf->enable();
+			k.process(buf + skip, take - skip, c, st,
+				opt.optLines, opt.optWords, opt.optBytes,
+				opt.optChars, opt.optMaxLine);
+			if (perf) perf->disable();
+			if (sum) sum->update(buf + skip, take - skip);
+		}
+		pos += (uint64_t)n;
+		t1 = Clock::now();
+		stats.kernelSec += secondsBetween(t2, t1);
+	}
+	int err = errno;
+	if (direct) fcntl(fd, F_SETFL, flags);
+	stats.syscalls += stats.reads;
+	errno = err;
+	return result;
+}
+#endif
+
+uint64_t extendLine(FILE* f, const KernelInfo& k, std::vector<unsigned char>& buffer,
+	const Options& opt, KernelState& st, Stats& stats)
+{
+	Counts line{};
+	for (;;) {
+		size_t n = fread(buffer.data(), 1, buffer.size(), f);
+		stats.reads++;
+		stats.syscalls++;
+		if (n == 0) break;
+		const void* nl = memchr(buffer.data(), '\n', n);
+		size_t upto = nl ? (size_t)((const unsigned char*)nl - buffer.data()) + 1 : n;
+		k.process(buffer.data(), upto, line, st, false, false, false, opt.optChars, true);
+		if (nl) return line.maxLineLength;
+	}
+	uint64_t len = st.currentLineLen;
+	st.currentLineLen = 0;
+	return len;
+}
+
+bool countStream(FILE* f, const KernelInfo& k, std::vector<unsigned char>& buffer,
+	const Options& opt, Counts& c, Stats& stats, PerfCounters* perf, Checksum* sum)
+{
+	KernelState st{};
+	if (perf) perf->reset();
+#ifdef __linux__
+	if (int device = countBlockDevice(f, k, buffer, opt, c, st, stats, perf, sum)) {
+		k.finalize(c, st, opt.optMaxLine);
+		return device > 0;
+	}
+#endif
+	uint64_t pos = 0, size = 0;
+	uint64_t remaining = opt.length;
+	// With --partition the slice continues the stream before it: the state
+	// is seeded from the bytes before the offset, the line the slice starts
+	// in (if it starts mid-line) is left to the previous slice for -L and
+	// the last line is followed past the end of the slice.
+	unsigned char before[3];
+	size_t nb = 0;
+	if (opt.offset) {
+		size_t back = opt.partition ? (size_t)std::min<uint64_t>(opt.offset, sizeof(before)) : 0;
+		if (seekInput(f, opt.offset - back)) {
+			stats.syscalls++;
+			nb = fread(before, 1, back, f);
+		}
+		else {
+			for (uint64_t skip = opt.offset; skip > 0;) {
+				size_t n = fread(buffer.data(), 1, (size_t)std::min<uint64_t>(buffer.size(), skip), f);
+				stats.reads++;
+				if (n == 0) break;
+				skip -= n;
+				size_t keep = std::min(n, back);
+				if (nb + keep > back) {
+					size_t drop = nb + keep - back;
+					memmove(before, before + drop, nb - drop);
+					nb -= drop;
+				}
+				memcpy(before + nb, buffer.data() + n - keep, keep);
+				nb += keep;
+			}
+		}
+		if (opt.partition) seedState(st, before, nb);
+	}
+	bool inHead = opt.partition && opt.optMaxLine && nb > 0 && before[nb - 1] != '\n';
+	unsigned char last = '\n';
+	bool sparse = isSparse(f) && regularFileSize(f, size) && tellInput(f, pos);
+	size = std::min(size, rangeEnd(opt));
+	Clock::time_point t1 = Clock::now();
+	while (remaining > 0) {
+		size_t want = (size_t)std::min<uint64_t>(buffer.size(), remaining);
+		if (sparse && pos < size) {
+			Extent e = nextExtent(f, pos, size);
+			stats.syscalls += e.hole ? 1 : 2;
+			if (e.hole) {
+				processZeros(e.length, c, st, opt.optWords, opt.optBytes, opt.optChars, opt.optMaxLine && !inHead);
+				if (sum) sum->updateZeros(e.length);
+				stats.bytes += e.length;
+				pos += e.length;
+				remaining -= e.length;
+				last = 0;
+			}
+			else if (e.length < want) {
+				want = (size_t)e.length;
+			}
+			seekInput(f, pos);
+			if (e.hole) continue;
+		}
+		size_t n = fread(buffer.data(), 1, want, f);
+		Clock::time_point t2 = Clock::now();
+		stats.readSec += secondsBetween(t1, t2);
+		stats.reads++;
+		stats.bytes += n;
+		pos += n;
+		remaining -= n;
+		if (n == 0) break;
+		if (perf) perf->enable();
+		size_t head = 0;
+		if (inHead) {
+			const void* nl = memchr(buffer.data(), '\n', n);
+			head = nl ? (size_t)((const unsigned char*)nl - buffer.data()) + 1 : n;
+			k.process(buffer.data(), head, c, st,
+				opt.optLines, opt.optWords, opt.optBytes,
+				opt.optChars, false);
+			inHead = nl == nullptr;
+		}
+		k.process(buffer.data() + head, n - head, c, st,
+			opt.optLines, opt.optWords, opt.optBytes,
+			opt.optChars, opt.optMaxLine);
+		if (perf) perf->disable();
+		if (sum) sum->update(buffer.data(), n);
+		last = buffer[n - 1];
+		t1 = Clock::now();
+		stats.kernelSec += secondsBetween(t2, t1);
+	}
+	if (opt.partition && opt.optMaxLine && remaining == 0 && !inHead && last != '\n')
+		c.maxLineLength = std::max(c.maxLineLength, extendLine(f, k, buffer, opt, st, stats));
+	k.finalize(c, st, opt.optMaxLine);
+	stats.syscalls += stats.reads;
+	return ferror(f) == 0;
+}
+
+#ifdef __linux__
+constexpr size_t kKernelCopySize = 1u << 30;
+
+// 1 when everything was copied, 0 when neither call applies to this pair
+// of descriptors (nothing copied yet), -1 on error.
+static int kernelCopy(int in, int out, uint64_t& copied, Stats& stats) {
+	bool useSendfile = false;
+	for (;;) {
+		ssize_t n = useSendfile ? sendfile(out, in, nullptr, kKernelCopySize)
+			: copy_file_range(in, nullptr, out, nullptr, kKernelCopySize, 0);
+		stats.syscalls++;
+		if (n > 0) {
+			copied += (uint64_t)n;
+			continue;
+		}
+		if (n == 0) return 1;
+		if (errno == EINTR) continue;
+		if (copied > 0 || (errno != EXDEV && errno != EINVAL && errno != ENOSYS && errno != EBADF && errno != EOPNOTSUPP))
+			return -1;
+		if (useSendfile) return 0;
+		useSendfile = true;
+	}
+}
+#endif
+
+int copyStream(FILE* f, FILE* out, const KernelInfo& k, std::vector<unsigned char>& buffer,
+	const Options& opt, Counts& c, Stats& stats, PerfCounters* perf, Checksum* sum)
+{
+	KernelState st{};
+	if (perf) perf->reset();
+#ifdef __linux__
+	// A failed kernel copy cannot tell which side failed, so read/write
+	// below carries on from where it stopped and finds out.
+	if (!opt.optLines && !opt.optWords && !opt.optChars && !opt.optMaxLine && !sum) {
+		if (fflush(out) != 0) return -1;
+		Clock::time_point t0 = Clock::now();
+		int r = kernelCopy(fileno(f), fileno(out), stats.bytes, stats);
+		stats.outputSec += secondsBetween(t0, Clock::now());
+		c.byteCount = stats.bytes;
+		if (r > 0) return 1;
+	}
+#endif
+	Clock::time_point t1 = Clock::now();
+	for (;;) {
+		size_t n = fread(buffer.data(), 1, buffer.size(), f);
+		Clock::time_point t2 = Clock::now();
+		stats.readSec += secondsBetween(t1, t2);
+		stats.reads++;
+		stats.bytes += n;
+		if (n == 0) break;
+		if (perf) perf->enable();
+		k.process(buffer.data(), n, c, st,
+			opt.optLines, opt.optWords, opt.optBytes,
+			opt.optChars, opt.optMaxLine);
+		if (perf) perf->disable();
+		if (sum) sum->update(buffer.data(), n);
+		Clock::time_point t3 = Clock::now();
+		stats.kernelSec += secondsBetween(t2, t3);
+		bool written = fwrite(buffer.data(), 1, n, out) == n;
+		stats.syscalls++;
+		t1 = Clock::now();
+		stats.outputSec += secondsBetween(t3, t1);
+		if (!written) return -1;
+	}
+	k.finalize(c, st, opt.optMaxLine);
+	stats.syscalls += stats.reads;
+	if (ferror(f)) return 0;
+	return fflush(out) == 0 ? 1 : -1;
+}
+
+bool isSmallFile(FILE* f, const Options& opt, uint64_t& size) {
+	return opt.offset == 0 && opt.length == UINT64_MAX && regularFileSize(f, size)
+		&& size > 0 && size < opt.bufSize / kMaxStreams;
+}
+
+void countSmallFiles(std::vector<SmallFile>& files, const KernelInfo& k, std::vector<unsigned char>& buffer,
+	const Options& opt)
+{
+	size_t part = buffer.size() / kMaxStreams;
+	const unsigned char* bufs[kMaxStreams];
+	size_t ns[kMaxStreams];
+	Counts counts[kMaxStreams];
+	KernelState states[kMaxStreams];
+	size_t stream[kMaxStreams];
+	size_t streams = 0;
+	Clock::time_point t1 = Clock::now();
+	for (size_t i = 0; i < files.size(); ++i) {
+		SmallFile& s = files[i];
+		unsigned char* dst = buffer.data() + streams * part;
+		// A byte more than expected, to notice growth.
+		size_t n = fread(dst, 1, (size_t)s.size + 1, s.f);
+		Clock::time_point t2 = Clock::now();
+		s.r.stats.readSec += secondsBetween(t1, t2);
+		t1 = t2;
+		stream[i] = SIZE_MAX;
+		if (ferror(s.f)) {
+			s.r.error = strerror(errno);
+			continue;
+		}
+		if (n > s.size) continue;
+		s.r.stats.reads++;
+		s.r.stats.bytes += n;
+		bufs[streams] = dst;
+		ns[streams] = n;
+		counts[streams] = Counts{};
+		states[streams] = KernelState{};
+		stream[i] = streams++;
+	}
+	if (k.processStreams) {
+		k.processStreams(bufs, ns, streams, counts, states,
+			opt.optLines, opt.optWords, opt.optBytes,
+			opt.optChars, opt.optMaxLine);
+	}
+	else {
+		for (size_t j = 0; j < streams; ++j)
+			k.process(bufs[j], ns[j], counts[j], states[j],
+				opt.optLines, opt.optWords, opt.optBytes,
+				opt.optChars, opt.optMaxLine);
+	}
+	double kernelSec = secondsBetween(t1, Clock::now());
+	uint64_t batchBytes = 0;
+	for (size_t j = 0; j < streams; ++j) batchBytes += ns[j];
+	for (size_t i = 0; i < files.size(); ++i) {
+		SmallFile& s = files[i];
+		size_t j = stream[i];
+		if (j == SIZE_MAX) continue;
+		k.finalize(counts[j], states[j], opt.optMaxLine);
+		s.r.counts = counts[j];
+		// Counted together: each gets its share of the kernel time.
+		s.r.stats.kernelSec += kernelSec * ns[j] / (double)std::max<uint64_t>(batchBytes, 1);
+		s.r.stats.syscalls += s.r.stats.reads;
+		Checksum sum(opt.checksum);
+		if (opt.checksum != Checksum::kNone) sum.update(bufs[j], ns[j]);
+		s.r.checksum = sum.hex();
+	}
+	// Files that grew are counted again from the start, reusing the whole
+	// buffer, so only once every part of it is finished with.
+	for (size_t i = 0; i < files.size(); ++i) {
+		SmallFile& s = files[i];
+		if (stream[i] == SIZE_MAX && s.r.error.empty()) {
+			if (seekInput(s.f, 0)) {
+				s.r.stats.syscalls++;
+				Checksum sum(opt.checksum);
+				if (!countStream(s.f, k, buffer, opt, s.r.counts, s.r.stats, nullptr,
+					opt.checksum != Checksum::kNone ? &sum : nullptr))
+					s.r.error = strerror(errno);
+				s.r.checksum = sum.hex();
+			}
+			else {
+				s.r.error = strerror(errno);
+			}
+		}
+		s.r.stats.syscalls++;
+		closeInput(s.f);
+		s.f = nullptr;
+	}
+}
+
+void countReader(StreamReader& in, uint64_t size, const KernelInfo& k, std::vector<unsigned char>& buffer,
+	const Options& opt, FileResult& r, PerfCounters* perf)
+{
+	KernelState st{};
+	Checksum sum(opt.checksum);
+	r.opened = true;
+	if (perf) perf->reset();
+	Clock::time_point t1 = Clock::now();
+	while (size > 0) {
+		size_t n = in.read(buffer.data(), (size_t)std::min<uint64_t>(buffer.size(), size));
+		Clock::time_point t2 = Clock::now();
+		r.stats.readSec += secondsBetween(t1, t2);
+		r.stats.reads++;
+		if (n == 0) {
+			r.opened = size == UINT64_MAX && in.error().empty();
+			break;
+		}
+		r.stats.bytes += n;
+		if (size != UINT64_MAX) size -= n;
+		if (perf) perf->enable();
+		k.process(buffer.data(), n, r.counts, st,
+			opt.optLines, opt.optWords, opt.optBytes,
+			opt.optChars, opt.optMaxLine);
+		if (perf) perf->disable();
+		sum.update(buffer.data(), n);
+		t1 = Clock::now();
+		r.stats.kernelSec += secondsBetween(t2, t1);
+	}
+	k.finalize(r.counts, st, opt.optMaxLine);
+	r.checksum = sum.hex();
+	if (perf) r.perf = perf->read();
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "checksum.h"
+#include "dispatch.h"
+#include "perf_counters.h"
+
+class StreamReader;
+
+static constexpr size_t kBufSize = 4u << 20;
+static constexpr size_t kMinBufSize = 64u << 10;
+
+struct Options {
+	bool optLines = false;
+	bool optWords = false;
+	bool optBytes = false;
+	bool optChars = false;
+	bool optMaxLine = false;
+	bool stats = false;
+	bool perf = false;
+	unsigned threads = 0;
+	uint64_t maxMemory = 0;
+	uint64_t offset = 0;
+	uint64_t length = UINT64_MAX;
+	bool partition = false;
+	bool tar = false;
+	bool zip = false;
+	bool passthrough = false;
+	Checksum::Algorithm checksum = Checksum::kNone;
+	size_t bufSize = kBufSize;
+	size_t cacheEntries = 1u << 16;
+	std::string kernel;
+	std::string serve;
+	std::string output;
+	std::vector<std::string> files;
+};
+
+struct Stats {
+	double openSec = 0;
+	double readSec = 0;
+	double kernelSec = 0;
+	double outputSec = 0;
+	uint64_t bytes = 0;
+	uint64_t reads = 0;
+	uint64_t syscalls = 0;
+};
+
+// One line of output: a file, or a member of an archive.
+struct FileResult {
+	bool opened = false;
+	Counts counts;
+	Stats stats;
+	PerfSample perf;
+	std::string checksum;
+	// Why counting stopped partway (a read error); the counts are not
+	// reported when set.
+	std::string error;
+};
+
+using Clock = std::chrono::steady_clock;
+inline double secondsBetween(Clock::time_point a, Clock::time_point b) {
+	return std::chrono::duration<double>(b - a).count();
+}
+
+// Bytes with optional K/M/G suffix.
+bool parseSize(const std::string& s, uint64_t& bytes);
+
+// Sets opt.threads to workers and, under --max-memory, shrinks the read
+// buffers, then the worker count, then the serve cache (entries of
+// cacheEntryBytes, at most an eighth of the budget) until buffers plus
+// perWorkerExtra for every worker fit. Buffers never go below kMinBufSize.
+void applyMemoryBudget(Options& opt, unsigned workers, size_t perWorkerExtra, size_t cacheEntryBytes);
+
+void addStats(Stats& total, const Stats& s);
+void addCounts(Counts& total, const Counts& c);
+// digest, when not empty, is printed between the counts and the label.
+std::string formatCounts(const Counts& c, const std::string* label, const Options& opt,
+	const std::string& digest = std::string());
+
+// stdin for "-", nullptr if the file cannot be opened.
+FILE* openInput(const std::string& path);
+void closeInput(FILE* f);
+// Size of f if it is a regular file; pipes, terminals and devices fail.
+bool regularFileSize(FILE* f, uint64_t& size);
+bool seekInput(FILE* f, uint64_t offset);
+bool tellInput(FILE* f, uint64_t& offset);
+
+// A regular file with fewer blocks allocated than its size. Always false
+// where SEEK_HOLE is not available.
+bool isSparse(FILE* f);
+
+// The run starting at offset: a hole (reads as zeros) or data, clipped to
+// limit. Moves the descriptor offset; seekInput before the next fread.
+struct Extent {
+	bool hole;
+	uint64_t length;
+};
+Extent nextExtent(FILE* f, uint64_t offset, uint64_t limit);
+
+// End of the --offset/--length range, UINT64_MAX when open-ended.
+uint64_t rangeEnd(const Options& opt);
+
+// Follows the line open in st from f's position to its '\n' (or EOF) and
+// returns its full length for -L. Nothing else is counted.
+uint64_t extendLine(FILE* f, const KernelInfo& k, std::vector<unsigned char>& buffer,
+	const Options& opt, KernelState& st, Stats& stats);
+
+// Counts everything readable from f (within --offset/--length) through
+// kernel k using buffer. perf, when given, is enabled only around the
+// kernel calls, and sum, when given, is updated with every byte counted.
+// Holes in sparse files are counted arithmetically instead of read; block
+// devices are read with large aligned preads. Returns false on a read
+// error (errno is set).
+bool countStream(FILE* f, const KernelInfo& k, std::vector<unsigned char>& buffer,
+	const Options& opt, Counts& c, Stats& stats, PerfCounters* perf = nullptr, Checksum* sum = nullptr);
+
+// Copies all of f to out while counting it, in the same pass: each buffer
+// is counted and then written. With -c alone the bytes are never seen, so
+// on Linux they are copied in the kernel (copy_file_range, else sendfile)
+// and only counted, unless sum needs them. Returns 1 when everything was
+// copied, 0 on a read error and -1 on a write error (errno is set).
+int copyStream(FILE* f, FILE* out, const KernelInfo& k, std::vector<unsigned char>& buffer,
+	const Options& opt, Counts& c, Stats& stats, PerfCounters* perf = nullptr, Checksum* sum = nullptr);
+
+// A small regular file, open, waiting for countSmallFiles.
+struct SmallFile {
+	std::string path;
+	FILE* f = nullptr;
+	uint64_t size = 0;
+	FileResult r;
+};
+
+// Whether f, just opened, can be counted by countSmallFiles with a buffer of
+// bufSize: a whole (no --offset/--length) regular file of 1 byte up to
+// just under a kMaxStreams-th of the buffer. Files reporting size 0, as
+// procfs ones do, are left to countStream.
+bool isSmallFile(FILE* f, const Options& opt, uint64_t& size);
+
+// Reads each of files (at most kMaxStreams) whole into its own part of
+// buffer in a single read and counts them together, through
+// k.processStreams when the kernel interleaves streams, then closes them.
+// One that grew past its part since it was opened is counted by
+// countStream instead; one that cannot be read gets r.error.
+void countSmallFiles(std::vector<SmallFile>& files, const KernelInfo& k, std::vector<unsigned char>& buffer,
+	const Options& opt);
+
+// Counts size bytes (everything, for UINT64_MAX) of decoded input from in,
+// an archive member, into r, with its --checksum digest. Fails with
+// r.opened false when in ends early.
+void countReader(StreamReader& in, uint64_t size, const KernelInfo& k, std::vector<unsigned char>& buffer,
+	const Options& opt, FileResult& r, PerfCounters* perf = nullptr);
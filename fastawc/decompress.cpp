@@ -0,0 +1,219 @@
+#include "decompress.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef FASTAWC_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef FASTAWC_HAVE_ZSTD
+#include <zstd.h>
+#include <zstd_errors.h>
+#endif
+
+namespace {
+constexpr size_t kInputSize = 256u << 10;
+// inflate's state and 32 KiB window; zstd's context and block buffers on
+// top of its window.
+constexpr size_t kZlibStateBytes = 64u << 10;
+constexpr size_t kZstdStateBytes = 512u << 10;
+}
+
+struct StreamReader::Codec {
+#ifdef FASTAWC_HAVE_ZLIB
+	z_stream zs{};
+	bool zlibInit = false;
+#endif
+#ifdef FASTAWC_HAVE_ZSTD
+	ZSTD_DStream* zstd = nullptr;
+	size_t zstdHint = 0;
+#endif
+	bool done = false;
+
+	~Codec() {
+#ifdef FASTAWC_HAVE_ZLIB
+		if (zlibInit) inflateEnd(&zs);
+#endif
+#ifdef FASTAWC_HAVE_ZSTD
+		if (zstd) ZSTD_freeDStream(zstd);
+#endif
+	}
+};
+
+StreamReader::StreamReader(FILE* f, Format format, uint64_t limit, size_t maxWindow)
+	: f_(f), format_(format), limit_(limit), codec_(new Codec)
+{
+	if (format_ == kAuto) {
+		in_.resize(4);
+		inLen_ = fread(in_.data(), 1, (size_t)std::min<uint64_t>(4, limit_), f_);
+		consumed_ = inLen_;
+		const unsigned char* p = in_.data();
+		if (inLen_ >= 2 && p[0] == 0x1F && p[1] == 0x8B) format_ = kGzip;
+		else if (inLen_ >= 4 && p[0] == 0x28 && p[1] == 0xB5 && p[2] == 0x2F && p[3] == 0xFD) format_ = kZstd;
+		else format_ = kPlain;
+	}
+	if (format_ == kGzip || format_ == kDeflateRaw) {
+#ifdef FASTAWC_HAVE_ZLIB
+		// 15 + 32: zlib or gzip header, detected; -15: no header.
+		codec_->zlibInit = inflateInit2(&codec_->zs, format_ == kGzip ? 15 + 32 : -15) == Z_OK;
+		if (!codec_->zlibInit) error_ = "cannot initialise zlib";
+#else
+		error_ = format_ == kGzip ? "gzip input needs zlib, not built in" : "deflate needs zlib, not built in";
+#endif
+	}
+	else if (format_ == kZstd) {
+#ifdef FASTAWC_HAVE_ZSTD
+		codec_->zstd = ZSTD_createDStream();
+		if (!codec_->zstd || ZSTD_isError(ZSTD_initDStream(codec_->zstd))) error_ = "cannot initialise zstd";
+		else if (maxWindow) {
+			int log = 10;
+			while (log < 31 && ((size_t)2 << log) <= maxWindow) ++log;
+			if (ZSTD_isError(ZSTD_DCtx_setParameter(codec_->zstd, ZSTD_d_windowLogMax, log))) error_ = "cannot initialise zstd";
+		}
+#else
+		(void)maxWindow;
+		error_ = "zstd input needs libzstd, not built in";
+#endif
+	}
+}
+
+StreamReader::~StreamReader() = default;
+
+size_t StreamReader::memoryBytes(Format format, size_t maxWindow) {
+	if (format == kPlain) return 4;
+	size_t zlib = kZlibStateBytes, zstd = maxWindow + kZstdStateBytes;
+	size_t codec = format == kZstd ? zstd : format == kAuto ? std::max(zlib, zstd) : zlib;
+	return kInputSize + codec;
+}
+
+size_t StreamReader::fill() {
+	if (inPos_ < inLen_) return inLen_ - inPos_;
+	if (eof_) return 0;
+	if (in_.size() < kInputSize) in_.resize(kInputSize);
+	size_t want = (size_t)std::min<uint64_t>(in_.size(), limit_ - consumed_);
+	inPos_ = 0;
+	inLen_ = want ? fread(in_.data(), 1, want, f_) : 0;
+	consumed_ += inLen_;
+	if (inLen_ == 0) eof_ = true;
+	return inLen_;
+}
+
+// Sniffed bytes first, then straight from f into dst.
+size_t StreamReader::readPlain(unsigned char* dst, size_t n) {
+	size_t got = std::min(n, inLen_ - inPos_);
+	memcpy(dst, in_.data() + inPos_, got);
+	inPos_ += got;
+	if (got < n && !eof_) {
+		size_t want = (size_t)std::min<uint64_t>(n - got, limit_ - consumed_);
+		size_t r = want ? fread(dst + got, 1, want, f_) : 0;
+		consumed_ += r;
+		if (r < want || want == 0) eof_ = true;
+		got += r;
+	}
+	return got;
+}
+
+size_t StreamReader::read(unsigned char* dst, size_t n) {
+	if (!error_.empty() || n == 0) return 0;
+	if (format_ == kPlain) return readPlain(dst, n);
+	if (codec_->done) return 0;
+#ifdef FASTAWC_HAVE_ZLIB
+	if (format_ == kGzip || format_ == kDeflateRaw) {
+		z_stream& zs = codec_->zs;
+		zs.next_out = dst;
+		zs.avail_out = (uInt)std::min<size_t>(n, 1u << 30);
+		size_t asked = zs.avail_out;
+		while (zs.avail_out > 0) {
+			if (zs.avail_in == 0) {
+				if (fill() == 0) {
+					error_ = "unexpected end of compressed data";
+					break;
+				}
+				zs.next_in = in_.data() + inPos_;
+				zs.avail_in = (uInt)(inLen_ - inPos_);
+				inPos_ = inLen_;
+			}
+			int ret = inflate(&zs, Z_NO_FLUSH);
+			if (ret == Z_STREAM_END) {
+				// Concatenated gzip members continue the stream.
+				if (format_ == kGzip && (zs.avail_in > 0 || fill() > 0)) {
+					if (zs.avail_in == 0) {
+						zs.next_in = in_.data() + inPos_;
+						zs.avail_in = (uInt)(inLen_ - inPos_);
+						inPos_ = inLen_;
+					}
+					inflateReset(&zs);
+					continue;
+				}
+				codec_->done = true;
+				break;
+			}
+			if (ret != Z_OK && ret != Z_BUF_ERROR) {
+				error_ = std::string("corrupt compressed data (") + (zs.msg ? zs.msg : "zlib error") + ")";
+				break;
+			}
+		}
+		return asked - zs.avail_out;
+	}
+#endif
+#ifdef FASTAWC_HAVE_ZSTD
+	if (format_ == kZstd) {
+		ZSTD_outBuffer out{ dst, n, 0 };
+		while (out.pos < out.size) {
+			if (inPos_ == inLen_ && fill() == 0) {
+				if (codec_->zstdHint != 0) error_ = "unexpected end of compressed data";
+				codec_->done = true;
+				break;
+			}
+			ZSTD_inBuffer in{ in_.data(), inLen_, inPos_ };
+			size_t ret = ZSTD_decompressStream(codec_->zstd, &out, &in);
+			inPos_ = in.pos;
+			if (ZSTD_isError(ret)) {
+				if (ZSTD_getErrorCode(ret) == ZSTD_error_frameParameter_windowTooLarge)
+					error_ = "zstd window larger than --max-memory allows";
+				else error_ = std::string("corrupt compressed data (") + ZSTD_getErrorName(ret) + ")";
+				break;
+			}
+			codec_->zstdHint = ret;
+		}
+		return out.pos;
+	}
+#endif
+	return 0;
+}
+
+bool StreamReader::readFull(unsigned char* dst, size_t n) {
+	size_t got = 0;
+	while (got < n) {
+		size_t r = read(dst + got, n - got);
+		if (r == 0) return false;
+		got += r;
+	}
+	return true;
+}
+
+bool StreamReader::skip(uint64_t n, std::vector<unsigned char>& scratch) {
+	if (format_ == kPlain) {
+		uint64_t buffered = std::min<uint64_t>(n, inLen_ - inPos_);
+		inPos_ += (size_t)buffered;
+		n -= buffered;
+		if (n == 0) return true;
+		if (n <= limit_ - consumed_ && fseek(f_, 0, SEEK_CUR) == 0) {
+#ifdef _MSC_VER
+			bool seeked = _fseeki64(f_, (__int64)n, SEEK_CUR) == 0;
+#else
+			bool seeked = fseeko(f_, (off_t)n, SEEK_CUR) == 0;
+#endif
+			if (seeked) {
+				consumed_ += n;
+				return true;
+			}
+		}
+	}
+	while (n > 0) {
+		size_t r = read(scratch.data(), (size_t)std::min<uint64_t>(scratch.size(), n));
+		if (r == 0) return false;
+		n -= r;
+	}
+	return true;
+}
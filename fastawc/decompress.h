@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Sequential reader returning the plain bytes of a plain, gzip, zstd or raw
+// deflate stream, reading at most limit bytes of (compressed) input from f.
+// kAuto sniffs gzip and zstd magic. gzip/deflate need zlib and zstd needs
+// libzstd at build time (FASTAWC_HAVE_ZLIB, FASTAWC_HAVE_ZSTD); without them
+// such input is an error rather than counted as compressed bytes.
+// maxWindow, when not 0, caps the zstd window and so the decoder's memory;
+// frames that need a larger one fail.
+class StreamReader {
+public:
+	enum Format { kAuto, kPlain, kGzip, kZstd, kDeflateRaw };
+
+	explicit StreamReader(FILE* f, Format format = kAuto, uint64_t limit = UINT64_MAX, size_t maxWindow = 0);
+	~StreamReader();
+	StreamReader(const StreamReader&) = delete;
+	StreamReader& operator=(const StreamReader&) = delete;
+
+	// Up to n bytes into dst, fewer only at the end of the stream; 0 at the
+	// end or on error (see error()).
+	size_t read(unsigned char* dst, size_t n);
+	// Reads exactly n bytes or fails.
+	bool readFull(unsigned char* dst, size_t n);
+	// Skips n bytes, seeking over plain seekable input.
+	bool skip(uint64_t n, std::vector<unsigned char>& scratch);
+
+	Format format() const { return format_; }
+	const std::string& error() const { return error_; }
+	// Compressed bytes consumed from f so far.
+	uint64_t inputBytes() const { return consumed_; }
+
+	// Upper bound of what a reader of format (kAuto: any) allocates itself,
+	// input buffer and decoder state, given its maxWindow (not 0).
+	static size_t memoryBytes(Format format, size_t maxWindow);
+
+private:
+	size_t fill();
+	size_t readPlain(unsigned char* dst, size_t n);
+
+	struct Codec;
+	FILE* f_;
+	Format format_;
+	uint64_t limit_;
+	uint64_t consumed_ = 0;
+	std::vector<unsigned char> in_;
+	size_t inPos_ = 0;
+	size_t inLen_ = 0;
+	bool eof_ = false;
+	std::unique_ptr<Codec> codec_;
+	std::string error_;
+};
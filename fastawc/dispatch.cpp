@@ -0,0 +1,88 @@
+#include "dispatch.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#if defined(__linux__) && defined(__aarch64__)
+#include <sys/auxv.h>
+#ifndef HWCAP_SVE
+#define HWCAP_SVE (1 << 22)
+#endif
+#endif
+
+bool cpuHasAvx2() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	int r[4];
+	__cpuid(r, 0);
+	if (r[0] < 7) return false;
+	__cpuid(r, 1);
+	bool osxsave = (r[2] & (1 << 27)) != 0;
+	bool avx = (r[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+	__cpuidex(r, 7, 0);
+	return (r[1] & (1 << 5)) != 0;
+#else
+	return false;
+#endif
+}
+
+bool cpuHasAvx512() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	int r[4];
+	__cpuid(r, 0);
+	if (r[0] < 7) return false;
+	__cpuid(r, 1);
+	if (!(r[2] & (1 << 27)) || (_xgetbv(0) & 0xE6) != 0xE6) return false;
+	__cpuidex(r, 7, 0);
+	return (r[1] & (1 << 16)) && (r[1] & (1 << 30));
+#else
+	return false;
+#endif
+}
+
+bool cpuHasSse42() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse4.2");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	int r[4];
+	__cpuid(r, 1);
+	return (r[2] & (1 << 20)) != 0;
+#else
+	return false;
+#endif
+}
+
+bool cpuHasSve() {
+#if defined(__linux__) && defined(__aarch64__)
+	return (getauxval(AT_HWCAP) & HWCAP_SVE) != 0;
+#else
+	return false;
+#endif
+}
+
+std::vector<const KernelInfo*> allKernels() {
+	std::vector<const KernelInfo*> v;
+	// SVE has not been measured against NEON on hardware yet, so it runs
+	// only when asked for with --kernel=sve.
+	for (const KernelInfo* k : { avx512Kernel(), avx2Kernel(), sse2Kernel(),
+		neonKernel(), sveKernel(), swarKernel(), scalarKernel() })
+		if (k) v.push_back(k);
+	return v;
+}
+
+const KernelInfo* selectKernel(const std::string& name) {
+	for (const KernelInfo* k : allKernels()) {
+		if (!name.empty() && name != k->name) continue;
+		if (k->supported()) return k;
+		if (!name.empty()) return nullptr;
+	}
+	return nullptr;
+}
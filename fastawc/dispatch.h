@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "kernels.h"
+
+// A counting kernel compiled in its own translation unit with its own
+// target flags, picked at runtime from what the CPU supports.
+struct KernelInfo {
+	const char* name;
+	bool (*supported)();
+	void (*process)(const unsigned char* buf, size_t n, Counts& out, KernelState& st,
+		bool countLines, bool countWords, bool countBytes,
+		bool countChars, bool countMaxLine);
+	void (*finalize)(Counts& out, KernelState& st, bool countMaxLine);
+	// Up to kMaxStreams independent buffers with their blocks interleaved;
+	// nullptr where there is nothing to overlap.
+	void (*processStreams)(const unsigned char* const* bufs, const size_t* n, size_t streams,
+		Counts* out, KernelState* st,
+		bool countLines, bool countWords, bool countBytes,
+		bool countChars, bool countMaxLine);
+};
+
+const KernelInfo* scalarKernel();
+const KernelInfo* swarKernel();
+const KernelInfo* sse2Kernel();
+const KernelInfo* avx2Kernel();
+const KernelInfo* avx512Kernel();
+const KernelInfo* neonKernel();
+const KernelInfo* sveKernel();
+
+bool cpuHasAvx2();
+// AVX-512 F and BW, with the OS saving the wider state.
+bool cpuHasAvx512();
+bool cpuHasSse42();
+bool cpuHasSve();
+
+// Every kernel built into this binary, fastest first.
+std::vector<const KernelInfo*> allKernels();
+// The fastest kernel this CPU runs, or the named one (nullptr if unknown
+// or unsupported).
+const KernelInfo* selectKernel(const std::string& name = "");
@@ -1,179 +1,103 @@
 #include <algorithm>
-#include <array>
+#include <cerrno>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <iostream>
+#include <memory>
+#include <thread>
 
-#define __AVX2__
+#include "archive.h"
+#include "count.h"
+#include "scheduler.h"
+#include "serve.h"
 
-#ifdef __AVX2__
-#include <immintrin.h>
-#endif
-
-struct Counts {
-	uint64_t lineCount = 0;
-	uint64_t wordCount = 0;
-	uint64_t byteCount = 0;
-	uint64_t charCount = 0;
-	uint64_t maxLineLength = 0;
-};
-
-struct Options {
-	bool optLines = false;
-	bool optWords = false;
-	bool optBytes = false;
-	bool optChars = false;
-	bool optMaxLine = false;
-	std::vector<std::string> files;
-};
-
-static constexpr size_t kBufSize = 4u << 20;
-
-alignas(32) static std::array<uint8_t, 256> gIsSpace{};
-inline void initSpaceTable() {
-	gIsSpace.fill(0);
-	gIsSpace[' '] = 1;
-	gIsSpace['\n'] = 1;
-	gIsSpace['\t'] = 1;
-	gIsSpace['\r'] = 1;
-	gIsSpace['\v'] = 1;
-	gIsSpace['\f'] = 1;
+static void printStats(const Stats& s, const std::string& label, const KernelInfo& kernel) {
+	double wall = s.openSec + s.readSec + s.kernelSec + s.outputSec;
+	char line[512];
+	snprintf(line, sizeof(line),
+		"fastawc: stats %s: open %.6fs read %.6fs kernel %.6fs output %.6fs, "
+		"%llu bytes, %.3f GB/s (kernel %.3f GB/s), %llu reads, %llu syscalls, kernel %s\n",
+		label.c_str(), s.openSec, s.readSec, s.kernelSec, s.outputSec,
+		(unsigned long long)s.bytes,
+		wall > 0 ? s.bytes / wall / 1e9 : 0.0,
+		s.kernelSec > 0 ? s.bytes / s.kernelSec / 1e9 : 0.0,
+		(unsigned long long)s.reads, (unsigned long long)s.syscalls, kernel.name);
+	std::cerr << line;
 }
-inline bool isSpaceAscii(unsigned char c) { return gIsSpace[c] != 0; }
-inline bool isUtf8Lead(unsigned char c) { return (c & 0xC0) != 0x80; }
 
-struct ScalarState {
-	bool prevSpace = true;
-	uint64_t currentLineLen = 0;
-};
-
-#ifdef __AVX2__
-struct Avx2State {
-	uint32_t prevSpaceBit = 1;
-	uint64_t currentLineLen = 0;
-};
-
-inline __m256i vset1(uint8_t c) { return _mm256_set1_epi8((char)c); }
-inline uint32_t maskNewlines32(const __m256i v) {
-	__m256i cmp = _mm256_cmpeq_epi8(v, vset1('\n'));
-	return (uint32_t)_mm256_movemask_epi8(cmp);
-}
-inline uint32_t maskWhitespace32(const __m256i v) {
-	__m256i mSpace = _mm256_cmpeq_epi8(v, vset1(' '));
-	__m256i mN = _mm256_cmpeq_epi8(v, vset1('\n'));
-	__m256i mT = _mm256_cmpeq_epi8(v, vset1('\t'));
-	__m256i mR = _mm256_cmpeq_epi8(v, vset1('\r'));
-	__m256i mV = _mm256_cmpeq_epi8(v, vset1('\v'));
-	__m256i mF = _mm256_cmpeq_epi8(v, vset1('\f'));
-	__m256i or1 = _mm256_or_si256(mSpace, mN);
-	__m256i or2 = _mm256_or_si256(mT, mR);
-	__m256i or3 = _mm256_or_si256(mV, mF);
-	__m256i or4 = _mm256_or_si256(or1, or2);
-	__m256i ws = _mm256_or_si256(or4, or3);
-	return (uint32_t)_mm256_movemask_epi8(ws);
-}
-inline uint32_t maskUtf8Lead32(const __m256i v) {
-	__m256i top2 = _mm256_and_si256(v, _mm256_set1_epi8((char)0xC0));
-	__m256i cmp = _mm256_cmpeq_epi8(top2, _mm256_set1_epi8((char)0x80));
-	__m256i lead = _mm256_xor_si256(cmp, _mm256_set1_epi8((char)0xFF));
-	return (uint32_t)_mm256_movemask_epi8(lead);
-}
-inline uint32_t popcnt32(uint32_t x) {
-#if defined(_MSC_VER)
-	return __popcnt(x);
-#else
-	return (uint32_t)__builtin_popcount(x);
-#endif
-}
-inline void processBlock32(const __m256i v, Counts& out, Avx2State& st,
-	bool countLines, bool countWords, bool countBytes,
-	bool countChars, bool countMaxLine)
-{
-	uint32_t nl = maskNewlines32(v);
-	if (countLines) out.lineCount += popcnt32(nl);
-	if (countWords) {
-		uint32_t ws = maskWhitespace32(v);
-		uint32_t prevShift = (ws << 1) | st.prevSpaceBit;
-		uint32_t startMask = (~ws) & prevShift;
-		out.wordCount += popcnt32(startMask);
-		st.prevSpaceBit = (ws >> 31) & 1u;
-	}
-	if (countBytes) out.byteCount += 32;
-	if (countChars) out.charCount += popcnt32(maskUtf8Lead32(v));
-}
-inline void processTail(const unsigned char* buf, size_t n, Counts& out, Avx2State& st,
-	bool countLines, bool countWords, bool countBytes,
-	bool countChars, bool countMaxLine)
-{
-	for (size_t i = 0; i < n; ++i) {
-		unsigned char c = buf[i];
-		if (countBytes) out.byteCount++;
-		if (countLines && c == '\n') out.lineCount++;
-		if (countWords) {
-			bool space = isSpaceAscii(c);
-			uint32_t prev = st.prevSpaceBit;
-			if (!space && prev) out.wordCount++;
-			st.prevSpaceBit = space ? 1u : 0u;
-		}
-		if (countChars) if (isUtf8Lead(c)) out.charCount++;
+static void printPerf(const PerfSample& p, uint64_t bytes, const std::string& label) {
+	std::string line = "fastawc: perf " + label + ":";
+	char item[96];
+	for (int e = 0; e < kPerfEventCount; ++e) {
+		if (p.valid[e]) snprintf(item, sizeof(item), " %s/B %.4g", kPerfEventNames[e], bytes ? (double)p.value[e] / bytes : 0.0);
+		else snprintf(item, sizeof(item), " %s/B n/a", kPerfEventNames[e]);
+		line += item;
 	}
-}
-#else
-inline void processScalar(const unsigned char* buf, size_t n, Counts& out, ScalarState& st,
-	bool countLines, bool countWords, bool countBytes,
-	bool countChars, bool countMaxLine)
-{
-	if (countBytes) out.byteCount += n;
-	for (size_t i = 0; i < n; ++i) {
-		unsigned char c = buf[i];
-		if (countLines && c == '\n') out.lineCount++;
-		bool space = isSpaceAscii(c);
-		if (countWords) {
-			if (!space && st.prevSpace) out.wordCount++;
-		}
-		st.prevSpace = space;
-		if (countChars) {
-			if (isUtf8Lead(c)) {
-				out.charCount++;
-				if (countMaxLine) st.currentLineLen++;
-			}
-		}
-		else if (countMaxLine) {
-			st.currentLineLen++;
-		}
-		if (countMaxLine && c == '\n') {
-			if (st.currentLineLen > out.maxLineLength) out.maxLineLength = st.currentLineLen;
-			st.currentLineLen = 0;
-		}
+	if (p.valid[kPerfCycles] && p.valid[kPerfInstructions] && p.value[kPerfCycles]) {
+		snprintf(item, sizeof(item), " IPC %.3f", (double)p.value[kPerfInstructions] / p.value[kPerfCycles]);
+		line += item;
 	}
-}
-
-inline void finalizeScalar(Counts& out, ScalarState& st, bool countMaxLine) {
-	if (countMaxLine && st.currentLineLen > out.maxLineLength)
-		out.maxLineLength = st.currentLineLen;
-}
-#endif
-
-static void printCounts(const Counts& c, const std::string* label,
-	bool lines, bool words, bool bytes, bool chars, bool maxLine)
-{
-	if (lines)   std::cout << c.lineCount << " ";
-	if (words)   std::cout << c.wordCount << " ";
-	if (bytes)   std::cout << c.byteCount << " ";
-	if (chars)   std::cout << c.charCount << " ";
-	if (maxLine) std::cout << c.maxLineLength << " ";
-	if (label)   std::cout << *label;
-	std::cout << "\n";
+	std::cerr << line << "\n";
 }
 
 int main(int argc, char** argv) {
 	initSpaceTable();
 	Options opt;
+	bool endOfOptions = false;
 	for (int i = 1; i < argc; ++i) {
 		std::string a = argv[i];
-		if (a.size() > 1 && a[0] == '-' && a[1] != '-') {
+		if (endOfOptions) {
+			opt.files.push_back(a);
+		}
+		else if (a == "--") {
+			endOfOptions = true;
+		}
+		else if (a.size() > 2 && a[0] == '-' && a[1] == '-') {
+			if (a == "--stats") opt.stats = true;
+			else if (a == "--perf") opt.perf = true;
+			else if (a.rfind("--kernel=", 0) == 0) opt.kernel = a.substr(9);
+			else if (a.rfind("--threads=", 0) == 0) {
+				opt.threads = (unsigned)strtoul(a.c_str() + 10, nullptr, 10);
+				if (opt.threads == 0) opt.threads = std::max(1u, std::thread::hardware_concurrency());
+			}
+			else if (a.rfind("--offset=", 0) == 0 || a.rfind("--length=", 0) == 0) {
+				uint64_t& v = a[2] == 'o' ? opt.offset : opt.length;
+				if (!parseSize(a.substr(a.find('=') + 1), v)) {
+					std::cerr << "fastawc: invalid size '" << a.substr(a.find('=') + 1) << "'\n";
+					return 1;
+				}
+			}
+			else if (a == "--partition") opt.partition = true;
+			else if (a == "--tar") opt.tar = true;
+			else if (a == "--zip") opt.zip = true;
+			else if (a == "--passthrough") opt.passthrough = true;
+			else if (a.rfind("--checksum=", 0) == 0) {
+				if (!Checksum::parse(a.substr(11), opt.checksum)) {
+					std::cerr << "fastawc: unknown checksum '" << a.substr(11) << "' (crc32c, xxh3 or blake3)\n";
+					return 1;
+				}
+			}
+			else if (a.rfind("--output=", 0) == 0) {
+				opt.output = a.substr(9);
+				opt.passthrough = true;
+			}
+			else if (a.rfind("--max-memory=", 0) == 0) {
+				if (!parseSize(a.substr(13), opt.maxMemory) || opt.maxMemory == 0) {
+					std::cerr << "fastawc: invalid memory size '" << a.substr(13) << "'\n";
+					return 1;
+				}
+			}
+			else if (a == "--serve" && i + 1 < argc) opt.serve = argv[++i];
+			else if (a.rfind("--serve=", 0) == 0) opt.serve = a.substr(8);
+			else {
+				std::cerr << "fastawc: unrecognized option '" << a << "'\n";
+				return 1;
+			}
+		}
+		else if (a.size() > 1 && a[0] == '-' && a[1] != '-') {
 			for (size_t j = 1; j < a.size(); ++j) {
 				char ch = a[j];
 				if (ch == 'l') opt.optLines = true;
@@ -190,92 +114,196 @@ int main(int argc, char** argv) {
 	if (!opt.optLines && !opt.optWords && !opt.optBytes && !opt.optChars && !opt.optMaxLine)
 		opt.optLines = opt.optWords = opt.optBytes = true;
 	if (opt.files.empty()) opt.files.push_back("-");
+	if (opt.kernel == "list") {
+		for (const KernelInfo* k : allKernels())
+			std::cout << k->name << (k->supported() ? "" : " (unsupported)") << "\n";
+		return 0;
+	}
+	const KernelInfo* kernel = selectKernel(opt.kernel);
+	if (!kernel) {
+		std::cerr << "fastawc: kernel '" << opt.kernel << "' is not available on this CPU\n";
+		return 1;
+	}
+
+	if (opt.passthrough && (!opt.serve.empty() || opt.tar || opt.zip || opt.partition || opt.offset || opt.length != UINT64_MAX)) {
+		std::cerr << "fastawc: --passthrough cannot be combined with --serve, --tar, --zip, --offset, --length or --partition\n";
+		return 1;
+	}
+	if ((opt.tar || opt.zip) && (!opt.serve.empty() || opt.partition || opt.offset || opt.length != UINT64_MAX)) {
+		std::cerr << "fastawc: --tar and --zip cannot be combined with --serve, --offset, --length or --partition\n";
+		return 1;
+	}
+	if (!opt.serve.empty() && opt.checksum != Checksum::kNone) {
+		std::cerr << "fastawc: --checksum cannot be combined with --serve\n";
+		return 1;
+	}
+	if (!opt.serve.empty()) return runServer(opt.serve, opt, *kernel);
+	if (opt.zip && opt.threads == 0) opt.threads = std::max(1u, std::thread::hardware_concurrency());
+	applyMemoryBudget(opt, opt.threads, opt.tar ? tarExtraBytes(opt) : opt.zip ? zipWorkerExtraBytes() : 0, 0);
 
-	std::vector<unsigned char> buffer(kBufSize);
 	Counts total{};
+	Stats totalStats{};
+	std::unique_ptr<PerfCounters> perf;
+	PerfSample totalPerf{};
+	if (opt.perf) {
+		perf.reset(new PerfCounters());
+		if (!perf->any()) {
+			std::cerr << "fastawc: --perf: hardware performance counters unavailable\n";
+			perf.reset();
+		}
+	}
 	bool haveTotal = (opt.files.size() > 1);
+	// --passthrough: the input goes to stdout (or --output) and counts to stderr.
+	std::ostream& countsOut = opt.passthrough ? std::cerr : std::cout;
+	FILE* out = nullptr;
+	if (opt.passthrough) {
+		out = opt.output.empty() ? stdout : fopen(opt.output.c_str(), "wb");
+		if (!out) {
+			std::cerr << "fastawc: cannot open " << opt.output << " for writing: " << strerror(errno) << "\n";
+			return 1;
+		}
+		setvbuf(out, nullptr, _IONBF, 0);
+	}
 
-	for (const auto& path : opt.files) {
-		FILE* f = nullptr;
-#ifdef _MSC_VER
-		if (path == "-") {
-			f = stdin;
+	// Like wc, any file that cannot be counted makes the exit status 1.
+	int status = 0;
+	auto report = [&](const std::string& path, FileResult& r) {
+		if (!r.opened) {
+			std::cerr << "fastawc: cannot open " << path << "\n";
+			status = 1;
+			return;
 		}
-		else {
-			errno_t err = fopen_s(&f, path.c_str(), "rb");
-			if (err != 0 || !f) {
-				std::cerr << "fastawc: cannot open " << path << "\n";
-				continue;
-			}
+		if (!r.error.empty()) {
+			std::cerr << "fastawc: " << path << ": " << r.error << "\n";
+			status = 1;
+			return;
 		}
-#else
-		if (path == "-") {
-			f = stdin;
+		Clock::time_point t0 = Clock::now();
+		countsOut << formatCounts(r.counts, path == "-" ? nullptr : &path, opt, r.checksum);
+		addCounts(total, r.counts);
+		r.stats.outputSec += secondsBetween(t0, Clock::now());
+		addStats(totalStats, r.stats);
+		if (opt.stats) printStats(r.stats, path, *kernel);
+		if (perf) {
+			printPerf(r.perf, r.stats.bytes, path);
+			for (int e = 0; e < kPerfEventCount; ++e) {
+				totalPerf.value[e] += r.perf.value[e];
+				totalPerf.valid[e] = totalPerf.valid[e] || r.perf.valid[e];
+			}
 		}
-		else {
-			f = fopen(path.c_str(), "rb");
+	};
+
+	if (opt.tar) {
+		std::vector<unsigned char> buffer(opt.bufSize);
+		size_t members = 0;
+		for (const auto& path : opt.files) {
+			FILE* f = openInput(path);
 			if (!f) {
 				std::cerr << "fastawc: cannot open " << path << "\n";
+				status = 1;
 				continue;
 			}
+			std::string err = countTar(f, path, *kernel, buffer, opt, perf.get(),
+				[&](const std::string& label, FileResult& r) { report(label, r); ++members; });
+			closeInput(f);
+			if (!err.empty()) {
+				std::cerr << "fastawc: " << path << ": " << err << "\n";
+				status = 1;
+			}
 		}
-#endif
-
-		Counts c{};
-#ifndef __AVX2__
-		ScalarState st{};
-		for (;;) {
-			size_t n = fread(buffer.data(), 1, buffer.size(), f);
-			if (n == 0) break;
-			processScalar(buffer.data(), n, c, st,
-				opt.optLines, opt.optWords, opt.optBytes,
-				opt.optChars, opt.optMaxLine);
+		haveTotal = members > 1;
+	}
+	else if (opt.zip) {
+		size_t members = 0;
+		for (const auto& path : opt.files) {
+			std::string err = countZip(path, *kernel, opt,
+				[&](const std::string& label, FileResult& r) { report(label, r); ++members; });
+			if (!err.empty()) {
+				std::cerr << "fastawc: " << path << ": " << err << "\n";
+				status = 1;
+			}
+		}
+		haveTotal = members > 1;
+	}
+	else if (opt.passthrough) {
+		std::vector<unsigned char> buffer(opt.bufSize);
+		for (const auto& path : opt.files) {
+			FileResult r;
+			FILE* f = openInput(path);
+			r.opened = f != nullptr;
+			if (f) {
+				Checksum sum(opt.checksum);
+				int copied = copyStream(f, out, *kernel, buffer, opt, r.counts, r.stats, perf.get(),
+					opt.checksum != Checksum::kNone ? &sum : nullptr);
+				r.checksum = sum.hex();
+				int err = errno;
+				closeInput(f);
+				if (copied < 0) {
+					std::cerr << "fastawc: write error: " << strerror(err) << "\n";
+					return 1;
+				}
+				if (copied == 0) r.error = strerror(err);
+				if (perf) r.perf = perf->read();
+			}
+			report(path, r);
+		}
+		if (out != stdout && fclose(out) != 0) {
+			std::cerr << "fastawc: write error: " << strerror(errno) << "\n";
+			return 1;
 		}
-		finalizeScalar(c, st, opt.optMaxLine);
-#else
-		Avx2State st{};
-		for (;;) {
-			size_t n = fread(buffer.data(), 1, buffer.size(), f);
-			if (n == 0) break;
-			size_t i = 0;
-			while (i + 32 <= n) {
-				__m256i v = _mm256_loadu_si256((const __m256i*)(buffer.data() + i));
-				processBlock32(v, c, st,
-					opt.optLines, opt.optWords, opt.optBytes,
-					opt.optChars, opt.optMaxLine);
-				i += 32;
+	}
+	else if (opt.threads > 1) {
+		countFilesParallel(opt, *kernel, opt.threads, [&](size_t i, FileResult& r) { report(opt.files[i], r); });
+	}
+	else {
+		std::vector<unsigned char> buffer(opt.bufSize);
+		// Small files wait, open, until kMaxStreams of them are counted
+		// together; any other file flushes them first, so output stays in
+		// order. Not under --perf, whose samples are per file.
+		std::vector<SmallFile> batch;
+		auto flush = [&] {
+			countSmallFiles(batch, *kernel, buffer, opt);
+			for (auto& s : batch) report(s.path, s.r);
+			batch.clear();
+		};
+		for (const auto& path : opt.files) {
+			FileResult r;
+			Clock::time_point t0 = Clock::now();
+			FILE* f = openInput(path);
+			r.opened = f != nullptr;
+			uint64_t size = 0;
+			if (f && !perf && path != "-" && isSmallFile(f, opt, size)) {
+				r.stats.syscalls++;
+				r.stats.openSec = secondsBetween(t0, Clock::now());
+				batch.push_back({ path, f, size, r });
+				if (batch.size() == kMaxStreams) flush();
+				continue;
 			}
-			if (i < n) {
-				processTail(buffer.data() + i, n - i, c, st,
-					opt.optLines, opt.optWords, opt.optBytes,
-					opt.optChars, opt.optMaxLine);
+			if (!batch.empty()) flush();
+			if (f) {
+				if (path != "-") r.stats.syscalls++;
+				r.stats.openSec = secondsBetween(t0, Clock::now());
+				Checksum sum(opt.checksum);
+				if (!countStream(f, *kernel, buffer, opt, r.counts, r.stats, perf.get(),
+					opt.checksum != Checksum::kNone ? &sum : nullptr))
+					r.error = strerror(errno);
+				r.checksum = sum.hex();
+				if (path != "-") r.stats.syscalls++;
+				closeInput(f);
+				if (perf) r.perf = perf->read();
 			}
+			report(path, r);
 		}
-		if (opt.optMaxLine && st.currentLineLen > c.maxLineLength)
-			c.maxLineLength = st.currentLineLen;
-#endif
-
-		if (path == "-") printCounts(c, nullptr,
-			opt.optLines, opt.optWords, opt.optBytes,
-			opt.optChars, opt.optMaxLine);
-		else             printCounts(c, &path,
-			opt.optLines, opt.optWords, opt.optBytes,
-			opt.optChars, opt.optMaxLine);
-
-		total.lineCount += c.lineCount;
-		total.wordCount += c.wordCount;
-		total.byteCount += c.byteCount;
-		total.charCount += c.charCount;
-		total.maxLineLength = std::max(total.maxLineLength, c.maxLineLength);
-
-		if (path != "-") fclose(f);
+		if (!batch.empty()) flush();
 	}
 
 	if (haveTotal) {
+		Clock::time_point t0 = Clock::now();
 		std::string label = "total";
-		printCounts(total, &label,
-			opt.optLines, opt.optWords, opt.optBytes,
-			opt.optChars, opt.optMaxLine);
+		countsOut << formatCounts(total, &label, opt);
+		totalStats.outputSec += secondsBetween(t0, Clock::now());
 	}
-	return 0;
+	if (opt.stats && haveTotal) printStats(totalStats, "total", *kernel);
+	if (perf && haveTotal) printPerf(totalPerf, totalStats.bytes, "total");
+	return status;
 }
@@ -0,0 +1,29 @@
+#include "dispatch.h"
+
+#ifdef __AVX2__
+static void process(const unsigned char* buf, size_t n, Counts& out, KernelState& st,
+	bool countLines, bool countWords, bool countBytes,
+	bool countChars, bool countMaxLine)
+{
+	processSimd<Avx2>(buf, n, out, st,
+		countLines, countWords, countBytes,
+		countChars, countMaxLine);
+}
+
+static void processMany(const unsigned char* const* bufs, const size_t* n, size_t streams,
+	Counts* out, KernelState* st,
+	bool countLines, bool countWords, bool countBytes,
+	bool countChars, bool countMaxLine)
+{
+	processStreams<Avx2>(bufs, n, streams, out, st,
+		countLines, countWords, countBytes,
+		countChars, countMaxLine);
+}
+
+const KernelInfo* avx2Kernel() {
+	static const KernelInfo k = { "avx2", cpuHasAvx2, process, finalizeScalar, processMany };
+	return &k;
+}
+#else
+const KernelInfo* avx2Kernel() { return nullptr; }
+#endif
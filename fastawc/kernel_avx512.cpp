@@ -0,0 +1,29 @@
+#include "dispatch.h"
+
+#ifdef __AVX512BW__
+static void process(const unsigned char* buf, size_t n, Counts& out, KernelState& st,
+	bool countLines, bool countWords, bool countBytes,
+	bool countChars, bool countMaxLine)
+{
+	processSimd<Avx512>(buf, n, out, st,
+		countLines, countWords, countBytes,
+		countChars, countMaxLine);
+}
+
+static void processMany(const unsigned char* const* bufs, const size_t* n, size_t streams,
+	Counts* out, KernelState* st,
+	bool countLines, bool countWords, bool countBytes,
+	bool countChars, bool countMaxLine)
+{
+	processStreams<Avx512>(bufs, n, streams, out, st,
+		countLines, countWords, countBytes,
+		countChars, countMaxLine);
+}
+
+const KernelInfo* avx512Kernel() {
+	static const KernelInfo k = { "avx512", cpuHasAvx512, process, finalizeScalar, processMany };
+	return &k;
+}
+#else
+const KernelInfo* avx512Kernel() { return nullptr; }
+#endif
@@ -0,0 +1,32 @@
+#include "dispatch.h"
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+static void process(const unsigned char* buf, size_t n, Counts& out, KernelState& st,
+	bool countLines, bool countWords, bool countBytes,
+	bool countChars, bool countMaxLine)
+{
+	processNeon(buf, n, out, st,
+		countLines, countWords, countBytes,
+		countChars, countMaxLine);
+}
+
+static void processMany(const unsigned char* const* bufs, const size_t* n, size_t streams,
+	Counts* out, KernelState* st,
+	bool countLines, bool countWords, bool countBytes,
+	bool countChars, bool countMaxLine)
+{
+	processStreams<Neon>(bufs, n, streams, out, st,
+		countLines, countWords, countBytes,
+		countChars, countMaxLine);
+}
+
+// Advanced SIMD is part of every AArch64 CPU.
+static bool supported() { return true; }
+
+const KernelInfo* neonKernel() {
+	static const KernelInfo k = { "neon", supported, process, finalizeScalar, processMany };
+	return &k;
+}
+#else
+const KernelInfo* neonKernel() { return nullptr; }
+#endif
@@ -0,0 +1,17 @@
+#include "dispatch.h"
+
+static void process(const unsigned char* buf, size_t n, Counts& out, KernelState& st,
+	bool countLines, bool countWords, bool countBytes,
+	bool countChars, bool countMaxLine)
+{
+	processScalar(buf, n, out, st,
+		countLines, countWords, countBytes,
+		countChars, countMaxLine);
+}
+
+static bool supported() { return true; }
+
+const KernelInfo* scalarKernel() {
+	static const KernelInfo k = { "scalar", supported, process, finalizeScalar, nullptr };
+	return &k;
+}
@@ -0,0 +1,32 @@
+#include "dispatch.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+static void process(const unsigned char* buf, size_t n, Counts& out, KernelState& st,
+	bool countLines, bool countWords, bool countBytes,
+	bool countChars, bool countMaxLine)
+{
+	processSimd<Sse2>(buf, n, out, st,
+		countLines, countWords, countBytes,
+		countChars, countMaxLine);
+}
+
+static void processMany(const unsigned char* const* bufs, const size_t* n, size_t streams,
+	Counts* out, KernelState* st,
+	bool countLines, bool countWords, bool countBytes,
+	bool countChars, bool countMaxLine)
+{
+	processStreams<Sse2>(bufs, n, streams, out, st,
+		countLines, countWords, countBytes,
+		countChars, countMaxLine);
+}
+
+// Part of every x86-64 CPU, and of any 32-bit build that enables it.
+static bool supported() { return true; }
+
+const KernelInfo* sse2Kernel() {
+	static const KernelInfo k = { "sse2", supported, process, finalizeScalar, processMany };
+	return &k;
+}
+#else
+const KernelInfo* sse2Kernel() { return nullptr; }
+#endif
@@ -0,0 +1,19 @@
+#include "dispatch.h"
+
+#ifdef __ARM_FEATURE_SVE
+static void process(const unsigned char* buf, size_t n, Counts& out, KernelState& st,
+	bool countLines, bool countWords, bool countBytes,
+	bool countChars, bool countMaxLine)
+{
+	processSve(buf, n, out, st,
+		countLines, countWords, countBytes,
+		countChars, countMaxLine);
+}
+
+const KernelInfo* sveKernel() {
+	static const KernelInfo k = { "sve", cpuHasSve, process, finalizeScalar, nullptr };
+	return &k;
+}
+#else
+const KernelInfo* sveKernel() { return nullptr; }
+#endif
@@ -0,0 +1,532 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "simd.h"
+
+#ifdef __ARM_FEATURE_SVE
+#include <arm_sve.h>
+#endif
+
+struct Counts {
+	uint64_t lineCount = 0;
+	uint64_t wordCount = 0;
+	uint64_t byteCount = 0;
+	uint64_t charCount = 0;
+	uint64_t maxLineLength = 0;
+};
+
+alignas(32) inline std::array<uint8_t, 256> gIsSpace{};
+static inline void initSpaceTable() {
+	gIsSpace.fill(0);
+	gIsSpace[' '] = 1;
+	gIsSpace['\n'] = 1;
+	gIsSpace['\t'] = 1;
+	gIsSpace['\r'] = 1;
+	gIsSpace['\v'] = 1;
+	gIsSpace['\f'] = 1;
+}
+static inline bool isSpaceAscii(unsigned char c) { return gIsSpace[c] != 0; }
+static inline bool isUtf8Lead(unsigned char c) { return (c & 0xC0) != 0x80; }
+static inline uint8_t utf8SeqLen(unsigned char lead) {
+	if (lead >= 0xF8) return 1;
+	if (lead >= 0xF0) return 4;
+	if (lead >= 0xE0) return 3;
+	if (lead >= 0xC0) return 2;
+	return 1;
+}
+
+// A UTF-8 sequence cut off by the end of the previous buffer. The carry
+// depends only on the last three bytes of the stream, so it is the same
+// however the stream was split into reads, and a chunk that starts
+// mid-stream rebuilds it from the three bytes before its start.
+struct Utf8Carry {
+	uint8_t len = 0;
+	uint8_t need = 0;
+	uint8_t bytes[4] = {};
+	bool pending() const { return len != 0; }
+};
+
+static inline void updateUtf8Carry(Utf8Carry& cr, const unsigned char* buf, size_t n) {
+	size_t i = 0;
+	if (cr.pending()) {
+		while (i < n && cr.len < cr.need && cr.len < sizeof(cr.bytes) && !isUtf8Lead(buf[i])) cr.bytes[cr.len++] = buf[i++];
+		if (cr.len < cr.need && i == n) return;
+		cr = Utf8Carry{};
+	}
+	for (size_t k = 1; k <= 3 && k <= n - i; ++k) {
+		unsigned char c = buf[n - k];
+		if (!isUtf8Lead(c)) continue;
+		uint8_t need = utf8SeqLen(c);
+		if (need > k) {
+			cr.need = need;
+			cr.len = (uint8_t)k;
+			for (size_t j = 0; j < k; ++j) cr.bytes[j] = buf[n - k + j];
+		}
+		break;
+	}
+}
+
+// Shared by every kernel so the dispatcher can pick one at runtime.
+struct KernelState {
+	uint32_t prevSpace = 1;
+	uint64_t currentLineLen = 0;
+	Utf8Carry carry;
+};
+using ScalarState = KernelState;
+
+static inline void seedState(KernelState& st, const unsigned char* before, size_t n) {
+	st = KernelState{};
+	if (n == 0) return;
+	st.prevSpace = isSpaceAscii(before[n - 1]) ? 1u : 0u;
+	size_t k = n < 3 ? n : 3;
+	updateUtf8Carry(st.carry, before + n - k, k);
+}
+
+// SWAR: eight bytes per 64-bit word, each classified into the high bit of
+// its byte. The tests are exact (no carries between bytes), so the masks can
+// be shifted by a byte to look at the previous one and summed per byte lane.
+static constexpr uint64_t kSwarHigh = 0x8080808080808080ull;
+static constexpr uint64_t kSwarLow7 = 0x7F7F7F7F7F7F7F7Full;
+static constexpr uint64_t kSwarOnes = 0x0101010101010101ull;
+
+// Little-endian, so byte i of the input is byte i of the word everywhere.
+static inline uint64_t swarLoad(const unsigned char* p) {
+	uint64_t w;
+	memcpy(&w, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	w = __builtin_bswap64(w);
+#endif
+	return w;
+}
+static inline uint64_t swarEq(uint64_t w, unsigned char c) {
+	uint64_t x = w ^ (kSwarOnes * c);
+	return ~(((x & kSwarLow7) + kSwarLow7) | x) & kSwarHigh;
+}
+// ' ' or '\t'..'\r': the low seven bits are >= 9 and < 14, the top bit clear.
+static inline uint64_t swarSpace(uint64_t w) {
+	uint64_t low = w & kSwarLow7;
+	uint64_t ge9 = low + kSwarOnes * (0x80 - 9);
+	uint64_t ge14 = low + kSwarOnes * (0x80 - 14);
+	return ((ge9 & ~ge14 & ~w) & kSwarHigh) | swarEq(w, ' ');
+}
+// 10xxxxxx: top bit set, next bit clear.
+static inline uint64_t swarCont(uint64_t w) {
+	return w & ~(w << 1) & kSwarHigh;
+}
+static inline uint32_t swarCount(uint64_t mask) {
+	return (uint32_t)(((mask >> 7) * kSwarOnes) >> 56);
+}
+// Sum of eight byte-lane counters of up to 255 each.
+static inline uint64_t swarSumLanes(uint64_t lanes) {
+	uint64_t pairs = (lanes & 0x00FF00FF00FF00FFull) + ((lanes >> 8) & 0x00FF00FF00FF00FFull);
+	return (pairs * 0x0001000100010001ull) >> 48;
+}
+
+// One word of which only the bytes with their high bit in valid are input.
+static inline void processWord64(uint64_t w, uint64_t valid, Counts& out, KernelState& st,
+	bool countLines, bool countWords, bool countChars, bool countMaxLine)
+{
+	uint64_t nl = swarEq(w, '\n') & valid;
+	if (countLines) out.lineCount += swarCount(nl);
+	if (countWords) {
+		uint64_t ws = swarSpace(w) & valid;
+		uint64_t starts = ~ws & ((ws << 8) | ((uint64_t)st.prevSpace << 7)) & valid;
+		out.wordCount += swarCount(starts);
+		int lastBit = 63 - 8 * (int)(8 - swarCount(valid));
+		st.prevSpace = (uint32_t)(ws >> lastBit) & 1u;
+	}
+	uint64_t units = countChars ? valid & ~swarCont(w) : valid;
+	if (countChars) out.charCount += swarCount(units);
+	if (countMaxLine) {
+		uint64_t done = 0;
+		for (uint64_t rest = nl; rest; rest &= rest - 1) {
+			uint64_t upto = rest ^ (rest - 1);
+			uint64_t len = st.currentLineLen + swarCount(units & upto & ~done);
+			if (len > out.maxLineLength) out.maxLineLength = len;
+			st.currentLineLen = 0;
+			done = upto;
+		}
+		st.currentLineLen += swarCount(units & ~done);
+	}
+}
+
+// Everything but the UTF-8 carry; also the tail of the vector kernels.
+static inline void processSwarWords(const unsigned char* buf, size_t n, Counts& out, KernelState& st,
+	bool countLines, bool countWords, bool countBytes,
+	bool countChars, bool countMaxLine)
+{
+	if (countBytes) out.byteCount += n;
+	size_t i = 0;
+	if (countMaxLine) {
+		for (; i + 8 <= n; i += 8)
+			processWord64(swarLoad(buf + i), kSwarHigh, out, st, countLines, countWords, countChars, true);
+	}
+	// Without -L the per-byte results are summed in byte lanes, folded every
+	// 255 words before a lane can overflow.
+	while (i + 8 <= n) {
+		size_t words = (n - i) / 8 < 255 ? (n - i) / 8 : 255;
+		uint64_t lines = 0, starts = 0, conts = 0;
+		uint64_t prev = (uint64_t)st.prevSpace << 7;
+		for (size_t k = 0; k < words; ++k, i += 8) {
+			uint64_t w = swarLoad(buf + i);
+			lines += swarEq(w, '\n') >> 7;
+			if (countWords) {
+				uint64_t ws = swarSpace(w);
+				starts += (~ws & ((ws << 8) | prev) & kSwarHigh) >> 7;
+				prev = (ws >> 56) & 0x80;
+			}
+			conts += swarCont(w) >> 7;
+		}
+		if (countLines) out.lineCount += swarSumLanes(lines);
+		if (countWords) {
+			out.wordCount += swarSumLanes(starts);
+			st.prevSpace = (uint32_t)(prev >> 7);
+		}
+		if (countChars) out.charCount += 8 * words - swarSumLanes(conts);
+	}
+	if (i < n) {
+		unsigned char last[8] = {};
+		memcpy(last, buf + i, n - i);
+		uint64_t valid = kSwarHigh >> (8 * (8 - (n - i)));
+		processWord64(swarLoad(last), valid, out, st, countLines, countWords, countChars, countMaxLine);
+	}
+}
+
+static inline void processSwar(const unsigned char* buf, size_t n, Counts& out, KernelState& st,
+	bool countLines, bool countWords, bool countBytes,
+	bool countChars, bool countMaxLine)
+{
+	processSwarWords(buf, n, out, st,
+		countLines, countWords, countBytes,
+		countChars, countMaxLine);
+	updateUtf8Carry(st.carry, buf, n);
+}
+
+// Fixed-width vector kernels, one template over the ISAs of simd.h.
+template <class V> static inline typename V::Mask maskNewlines(const typename V::Reg v) {
+	return V::eq(v, '\n');
+}
+// ' ' or '\t'..'\r', the latter as one unsigned range compare.
+template <class V> static inline typename V::Mask maskWhitespace(const typename V::Reg v) {
+	return V::eq(v, ' ') | V::le(V::sub(v, '\t'), '\r' - '\t');
+}
+template <class V> static inline typename V::Mask maskUtf8Lead(const typename V::Reg v) {
+	return ~V::eq(V::andb(v, 0xC0), 0x80) & V::kAll;
+}
+// Only the lanes set in valid are input, a contiguous run: the high lanes of
+// a load overlapping bytes already counted, or the low lanes of a short one.
+template <class V>
+static inline void processMasked(const typename V::Reg v, typename V::Mask valid, Counts& out, KernelState& st,
+	bool countLines, bool countWords, bool countBytes,
+	bool countChars, bool countMaxLine)
+{
+	using Mask = typename V::Mask;
+	Mask nl = maskNewlines<V>(v) & valid;
+	if (countLines) out.lineCount += popcnt64(nl);
+	if (countWords) {
+		Mask ws = maskWhitespace<V>(v) & valid;
+		Mask first = valid & (0 - valid);
+		Mask last = valid ^ (valid >> V::kLaneBits & valid);
+		Mask prevShift = (Mask)(ws << V::kLaneBits) | (st.prevSpace ? first : 0);
+		Mask startMask = (~ws) & prevShift & valid;
+		out.wordCount += popcnt64(startMask);
+		st.prevSpace = (ws & last) ? 1u : 0u;
+	}
+	if (countBytes) out.byteCount += popcnt64(valid);
+	Mask lead = (countChars) ? maskUtf8Lead<V>(v) & valid : 0;
+	if (countChars) out.charCount += popcnt64(lead);
+	if (countMaxLine) {
+		Mask units = countChars ? lead : valid;
+		Mask done = 0;
+		for (Mask rest = nl; rest; rest &= rest - 1) {
+			Mask upto = rest ^ (rest - 1);
+			uint64_t len = st.currentLineLen + popcnt64(units & upto & ~done);
+			if (len > out.maxLineLength) out.maxLineLength = len;
+			st.currentLineLen = 0;
+			done = upto;
+		}
+		st.currentLineLen += popcnt64(units & ~done);
+	}
+}
+template <class V>
+static inline void processBlock(const typename V::Reg v, Counts& out, KernelState& st,
+	bool countLines, bool countWords, bool countBytes,
+	bool countChars, bool countMaxLine)
+{
+	processMasked<V>(v, V::kAll, out, st,
+		countLines, countWords, countBytes,
+		countChars, countMaxLine);
+}
+// A buffer of fewer than kWidth bytes, which must not be read past.
+template <class V>
+static inline void processTail(const unsigned char* buf, size_t n, Counts& out, KernelState& st,
+	bool countLines, bool countWords, bool countBytes,
+	bool countChars, bool countMaxLine)
+{
+	processMasked<V>(V::loadShort(buf, n), V::kAll >> (V::kLaneBits * (V::kWidth - n)), out, st,
+		countLines, countWords, countBytes,
+		countChars, countMaxLine);
+}
+// Bytes [i, n) of buf, without the UTF-8 carry. The tail is the top of the
+// last kWidth bytes when there are that many, so short reads off a pipe stay
+// in vectors too.
+template <class V>
+static inline void processVectors(const unsigned char* buf, size_t n, size_t i, Counts& out, KernelState& st,
+	bool countLines, bool countWords, bool countBytes,
+	bool countChars, bool countMaxLine)
+{
+	while (i + V::kWidth <= n) {
+		processBlock<V>(V::load(buf + i), out, st,
+			countLines, countWords, countBytes,
+			countChars, countMaxLine);
+		i += V::kWidth;
+	}
+	if (i < n) {
+		typename V::Reg v;
+		typename V::Mask valid;
+		if (n >= V::kWidth) {
+			v = V::load(buf + n - V::kWidth);
+			valid = V::kAll & (V::kAll << (V::kLaneBits * (V::kWidth - (n - i))));
+		}
+		else {
+			v = V::loadShort(buf, n);
+			valid = V::kAll >> (V::kLaneBits * (V::kWidth - n));
+		}
+		processMasked<V>(v, valid, out, st,
+			countLines, countWords, countBytes,
+			countChars, countMaxLine);
+	}
+}
+template <class V>
+static inline void processSimd(const unsigned char* buf, size_t n, Counts& out, KernelState& st,
+	bool countLines, bool countWords, bool countBytes,
+	bool countChars, bool countMaxLine)
+{
+	processVectors<V>(buf, n, 0, out, st,
+		countLines, countWords, countBytes,
+		countChars, countMaxLine);
+	updateUtf8Carry(st.carry, buf, n);
+}
+
+// Several independent buffers (small files) in one thread: their blocks
+// are interleaved so each stream's carried state (prevSpace, the open line)
+// no longer serializes the loop. Each stream has its own Counts and state.
+static constexpr size_t kMaxStreams = 4;
+
+template <class V, size_t S>
+static inline void interleaveBlocks(const unsigned char* const* bufs, const size_t* idx, size_t* pos,
+	size_t blocks, Counts* outs, KernelState* sts,
+	bool countLines, bool countWords, bool countBytes,
+	bool countChars, bool countMaxLine)
+{
+	// Local copies, so the states live in registers across the loop.
+	const unsigned char* p[S];
+	Counts c[S];
+	KernelState st[S];
+	for (size_t s = 0; s < S; ++s) {
+		p[s] = bufs[idx[s]] + pos[idx[s]];
+		c[s] = outs[idx[s]];
+		st[s] = sts[idx[s]];
+	}
+	for (size_t b = 0; b < blocks; ++b) {
+		// Unrolled, or the copies go through memory and the loop runs at
+		// half speed.
+#if defined(__GNUC__)
+#pragma GCC unroll 4
+#endif
+		for (size_t s = 0; s < S; ++s) {
+			processBlock<V>(V::load(p[s] + b * V::kWidth), c[s], st[s],
+				countLines, countWords, countBytes,
+				countChars, countMaxLine);
+		}
+	}
+	for (size_t s = 0; s < S; ++s) {
+		outs[idx[s]] = c[s];
+		sts[idx[s]] = st[s];
+		pos[idx[s]] += blocks * V::kWidth;
+	}
+}
+template <class V>
+static inline void processStreams(const unsigned char* const* bufs, const size_t* ns, size_t streams,
+	Counts* outs, KernelState* sts,
+	bool countLines, bool countWords, bool countBytes,
+	bool countChars, bool countMaxLine)
+{
+	size_t pos[kMaxStreams] = {};
+	// While two or more streams have whole blocks left, run the ones that do
+	// together up to the shortest; then each finishes alone. With -L the
+	// line-length state of four streams no longer fits in registers and
+	// interleaving is slower, so each goes alone from the start.
+	while (!countMaxLine) {
+		size_t idx[kMaxStreams], active = 0, blocks = SIZE_MAX;
+		for (size_t s = 0; s < streams; ++s) {
+			size_t left = (ns[s] - pos[s]) / V::kWidth;
+			if (left == 0) continue;
+			idx[active++] = s;
+			if (left < blocks) blocks = left;
+		}
+		if (active < 2) break;
+		if (active == 2)
+			interleaveBlocks<V, 2>(bufs, idx, pos, blocks, outs, sts,
+				countLines, countWords, countBytes, countChars, countMaxLine);
+		else if (active == 3)
+			interleaveBlocks<V, 3>(bufs, idx, pos, blocks, outs, sts,
+				countLines, countWords, countBytes, countChars, countMaxLine);
+		else
+			interleaveBlocks<V, 4>(bufs, idx, pos, blocks, outs, sts,
+				countLines, countWords, countBytes, countChars, countMaxLine);
+	}
+	for (size_t s = 0; s < streams; ++s) {
+		processVectors<V>(bufs[s], ns[s], pos[s], outs[s], sts[s],
+			countLines, countWords, countBytes,
+			countChars, countMaxLine);
+		updateUtf8Carry(sts[s].carry, bufs[s], ns[s]);
+	}
+}
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+// Without -L nothing needs positions, and NEON's narrowing movemask costs
+// more than it does on x86: compare results are subtracted into byte-lane
+// counters (0xFF is -1) 64 bytes at a time and summed with vaddlvq every 63
+// blocks, before a lane can pass 255.
+static inline size_t processBlocks64(const unsigned char* buf, size_t n, Counts& out, KernelState& st,
+	bool countLines, bool countWords, bool countChars)
+{
+	size_t i = 0;
+	uint8x16_t prevWs = vdupq_n_u8(st.prevSpace ? 0xFF : 0);
+	while (i + 64 <= n) {
+		size_t blocks = (n - i) / 64 < 63 ? (n - i) / 64 : 63;
+		uint8x16_t lines = vdupq_n_u8(0), starts = vdupq_n_u8(0), conts = vdupq_n_u8(0);
+		for (size_t b = 0; b < blocks; ++b, i += 64) {
+			for (int j = 0; j < 4; ++j) {
+				uint8x16_t v = vld1q_u8(buf + i + 16 * j);
+				lines = vsubq_u8(lines, vceqq_u8(v, vdupq_n_u8('\n')));
+				if (countWords) {
+					uint8x16_t range = vcleq_u8(vsubq_u8(v, vdupq_n_u8('\t')), vdupq_n_u8('\r' - '\t'));
+					uint8x16_t ws = vorrq_u8(range, vceqq_u8(v, vdupq_n_u8(' ')));
+					starts = vsubq_u8(starts, vbicq_u8(vextq_u8(prevWs, ws, 15), ws));
+					prevWs = ws;
+				}
+				conts = vsubq_u8(conts, vceqq_u8(vandq_u8(v, vdupq_n_u8(0xC0)), vdupq_n_u8(0x80)));
+			}
+		}
+		if (countLines) out.lineCount += vaddlvq_u8(lines);
+		if (countWords) out.wordCount += vaddlvq_u8(starts);
+		if (countChars) out.charCount += 64 * blocks - vaddlvq_u8(conts);
+	}
+	st.prevSpace = vgetq_lane_u8(prevWs, 15) & 1u;
+	return i;
+}
+static inline void processNeon(const unsigned char* buf, size_t n, Counts& out, KernelState& st,
+	bool countLines, bool countWords, bool countBytes,
+	bool countChars, bool countMaxLine)
+{
+	size_t i = 0;
+	if (!countMaxLine) {
+		i = processBlocks64(buf, n, out, st, countLines, countWords, countChars);
+		if (countBytes) out.byteCount += i;
+	}
+	processVectors<Neon>(buf, n, i, out, st,
+		countLines, countWords, countBytes,
+		countChars, countMaxLine);
+	updateUtf8Carry(st.carry, buf, n);
+}
+#endif
+
+#ifdef __ARM_FEATURE_SVE
+// Vector-length agnostic: the loop predicate covers the tail, so there is no
+// scalar remainder at all, and the counts are predicate popcounts.
+static inline void processSve(const unsigned char* buf, size_t n, Counts& out, KernelState& st,
+	bool countLines, bool countWords, bool countBytes,
+	bool countChars, bool countMaxLine)
+{
+	if (countBytes) out.byteCount += n;
+	uint8_t prevSpace = (uint8_t)st.prevSpace;
+	for (uint64_t i = 0; i < n; i += svcntb()) {
+		svbool_t pg = svwhilelt_b8(i, (uint64_t)n);
+		svuint8_t v = svld1_u8(pg, buf + i);
+		svbool_t nl = svcmpeq_n_u8(pg, v, '\n');
+		if (countLines) out.lineCount += svcntp_b8(pg, nl);
+		if (countWords) {
+			svbool_t range = svcmplt_n_u8(pg, svsub_n_u8_x(pg, v, '\t'), 5);
+			svbool_t ws = svorr_b_z(pg, range, svcmpeq_n_u8(pg, v, ' '));
+			// Each lane's predecessor: the flags shifted up one, the last
+			// flag of the previous vector inserted at lane 0.
+			svuint8_t flags = svdup_n_u8_z(ws, 1);
+			svbool_t prevWs = svcmpne_n_u8(pg, svinsr_n_u8(flags, prevSpace), 0);
+			out.wordCount += svcntp_b8(pg, svbic_b_z(pg, prevWs, ws));
+			prevSpace = svlastb_u8(pg, flags);
+		}
+		svbool_t units = countChars ? svcmpne_n_u8(pg, svand_n_u8_x(pg, v, 0xC0), 0x80) : pg;
+		if (countChars) out.charCount += svcntp_b8(pg, units);
+		if (countMaxLine) {
+			svbool_t done = svpfalse_b();
+			for (svbool_t rest = nl; svptest_any(pg, rest);) {
+				svbool_t upto = svbrka_b_z(pg, rest);
+				uint64_t len = st.currentLineLen + svcntp_b8(svbic_b_z(pg, upto, done), units);
+				if (len > out.maxLineLength) out.maxLineLength = len;
+				st.currentLineLen = 0;
+				done = upto;
+				rest = svbic_b_z(pg, rest, upto);
+			}
+			st.currentLineLen += svcntp_b8(svbic_b_z(pg, pg, done), units);
+		}
+	}
+	st.prevSpace = prevSpace;
+	updateUtf8Carry(st.carry, buf, n);
+}
+#endif
+
+static inline void processScalar(const unsigned char* buf, size_t n, Counts& out, ScalarState& st,
+	bool countLines, bool countWords, bool countBytes,
+	bool countChars, bool countMaxLine)
+{
+	if (countBytes) out.byteCount += n;
+	for (size_t i = 0; i < n; ++i) {
+		unsigned char c = buf[i];
+		if (countLines && c == '\n') out.lineCount++;
+		bool space = isSpaceAscii(c);
+		if (countWords) {
+			if (!space && st.prevSpace) out.wordCount++;
+		}
+		st.prevSpace = space ? 1u : 0u;
+		if (countChars) {
+			if (isUtf8Lead(c)) {
+				out.charCount++;
+				if (countMaxLine) st.currentLineLen++;
+			}
+		}
+		else if (countMaxLine) {
+			st.currentLineLen++;
+		}
+		if (countMaxLine && c == '\n') {
+			if (st.currentLineLen > out.maxLineLength) out.maxLineLength = st.currentLineLen;
+			st.currentLineLen = 0;
+		}
+	}
+	updateUtf8Carry(st.carry, buf, n);
+}
+
+static inline void finalizeScalar(Counts& out, ScalarState& st, bool countMaxLine) {
+	if (countMaxLine && st.currentLineLen > out.maxLineLength)
+		out.maxLineLength = st.currentLineLen;
+}
+
+// n zero bytes, as read from a hole in a sparse file: no newlines, no
+// whitespace, every byte a character (and a UTF-8 lead, ending any pending
+// sequence), one word if the preceding byte was whitespace.
+static inline void processZeros(uint64_t n, Counts& out, KernelState& st,
+	bool countWords, bool countBytes, bool countChars, bool countMaxLine)
+{
+	if (n == 0) return;
+	if (countBytes) out.byteCount += n;
+	if (countChars) out.charCount += n;
+	if (countWords && st.prevSpace) out.wordCount++;
+	st.prevSpace = 0;
+	if (countMaxLine) st.currentLineLen += n;
+	st.carry = Utf8Carry{};
+}
@@ -0,0 +1,107 @@
+#include "numa.h"
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+static std::vector<int> parseCpuList(const std::string& s) {
+	std::vector<int> cpus;
+	size_t pos = 0;
+	while (pos < s.size()) {
+		char* end = nullptr;
+		long lo = strtol(s.c_str() + pos, &end, 10);
+		if (end == s.c_str() + pos) break;
+		long hi = lo;
+		pos = (size_t)(end - s.c_str());
+		if (pos < s.size() && s[pos] == '-') {
+			hi = strtol(s.c_str() + pos + 1, &end, 10);
+			pos = (size_t)(end - s.c_str());
+		}
+		for (long c = lo; c <= hi; ++c) cpus.push_back((int)c);
+		if (pos < s.size() && s[pos] == ',') ++pos;
+		else break;
+	}
+	return cpus;
+}
+
+NumaTopology readNumaTopology() {
+	NumaTopology t;
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return t;
+	DIR* d = opendir("/sys/devices/system/node");
+	if (!d) return t;
+	while (dirent* e = readdir(d)) {
+		if (strncmp(e->d_name, "node", 4) != 0 || !isdigit((unsigned char)e->d_name[4])) continue;
+		std::ifstream in(std::string("/sys/devices/system/node/") + e->d_name + "/cpulist");
+		std::string list;
+		if (!std::getline(in, list)) continue;
+		std::vector<int> cpus;
+		for (int c : parseCpuList(list))
+			if (c < CPU_SETSIZE && CPU_ISSET(c, &allowed)) cpus.push_back(c);
+		if (cpus.empty()) continue;
+		t.nodeIds.push_back(atoi(e->d_name + 4));
+		t.cpus.push_back(cpus);
+	}
+	closedir(d);
+	if (t.size() < 2) return NumaTopology{};
+	return t;
+}
+
+bool pinThread(const std::vector<int>& cpus) {
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int c : cpus) CPU_SET(c, &set);
+	return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+int fileRangeNode(FILE* f, uint64_t offset, uint64_t length) {
+	static const long kPage = sysconf(_SC_PAGESIZE);
+	constexpr int kSamples = 8;
+	uint64_t base = offset & ~(uint64_t)(kPage - 1);
+	uint64_t span = offset + length - base;
+	void* map = mmap(nullptr, (size_t)span, PROT_READ, MAP_SHARED, fileno(f), (off_t)base);
+	if (map == MAP_FAILED) return -1;
+	void* pages[kSamples];
+	int status[kSamples];
+	unsigned char resident;
+	int n = 0;
+	for (int i = 0; i < kSamples; ++i) {
+		uint64_t at = (span / kSamples * i) & ~(uint64_t)(kPage - 1);
+		void* p = (char*)map + at;
+		// Only ask about pages already in the page cache; faulting the rest in
+		// would read the file just to place it.
+		if (mincore(p, 1, &resident) != 0 || !(resident & 1)) continue;
+		(void)*(volatile unsigned char*)p;
+		pages[n++] = p;
+	}
+	int node = -1;
+	if (n > 0 && syscall(SYS_move_pages, 0, (unsigned long)n, pages, nullptr, status, 0) == 0) {
+		int best = 0;
+		for (int i = 0; i < n; ++i) {
+			if (status[i] < 0) continue;
+			int votes = 0;
+			for (int j = 0; j < n; ++j) votes += status[j] == status[i];
+			if (votes > best) {
+				best = votes;
+				node = status[i];
+			}
+		}
+	}
+	munmap(map, (size_t)span);
+	return node;
+}
+#else
+NumaTopology readNumaTopology() { return NumaTopology{}; }
+bool pinThread(const std::vector<int>&) { return false; }
+int fileRangeNode(FILE*, uint64_t, uint64_t) { return -1; }
+#endif
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// NUMA nodes with the CPUs this process may run on, read from
+// /sys/devices/system/node. Empty when there is only one node or the
+// platform does not expose the topology, in which case callers skip all
+// placement.
+struct NumaTopology {
+	std::vector<int> nodeIds;
+	std::vector<std::vector<int>> cpus;
+	size_t size() const { return nodeIds.size(); }
+};
+
+NumaTopology readNumaTopology();
+
+// Restricts the calling thread to cpus.
+bool pinThread(const std::vector<int>& cpus);
+
+// Node holding most of the sampled page-cache pages of [offset, offset+length)
+// of f, or -1 when unknown (not cached, not Linux).
+int fileRangeNode(FILE* f, uint64_t offset, uint64_t length);
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+enum PerfEvent {
+	kPerfCycles,
+	kPerfInstructions,
+	kPerfCacheMisses,
+	kPerfBranchMisses,
+	kPerfDtlbMisses,
+	kPerfEventCount
+};
+
+static constexpr const char* kPerfEventNames[kPerfEventCount] = {
+	"cycles", "instructions", "cache-misses", "branch-misses", "dTLB-misses"
+};
+
+struct PerfSample {
+	uint64_t value[kPerfEventCount] = {};
+	bool valid[kPerfEventCount] = {};
+};
+
+// Counts hardware events of the calling thread (user space only). Events the
+// kernel or hypervisor refuses are left invalid; callers fall back to
+// wall-clock/TSC figures.
+class PerfCounters {
+public:
+	PerfCounters() {
+		for (int& fd : fds_) fd = -1;
+#ifdef __linux__
+		static const uint32_t kType[kPerfEventCount] = {
+			PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+			PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+		};
+		static const uint64_t kConfig[kPerfEventCount] = {
+			PERF_COUNT_HW_CPU_CYCLES,
+			PERF_COUNT_HW_INSTRUCTIONS,
+			PERF_COUNT_HW_CACHE_MISSES,
+			PERF_COUNT_HW_BRANCH_MISSES,
+			PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+		};
+		for (int e = 0; e < kPerfEventCount; ++e) {
+			perf_event_attr attr{};
+			attr.size = sizeof(attr);
+			attr.type = kType[e];
+			attr.config = kConfig[e];
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			fds_[e] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		}
+#endif
+	}
+	~PerfCounters() {
+#ifdef __linux__
+		for (int fd : fds_) if (fd >= 0) close(fd);
+#endif
+	}
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	bool any() const {
+		for (int fd : fds_) if (fd >= 0) return true;
+		return false;
+	}
+	void reset() {
+#ifdef __linux__
+		for (int fd : fds_) if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+#endif
+	}
+	void enable() {
+#ifdef __linux__
+		for (int fd : fds_) if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+	}
+	void disable() {
+#ifdef __linux__
+		for (int fd : fds_) if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+	}
+	PerfSample read() const {
+		PerfSample s;
+#ifdef __linux__
+		for (int e = 0; e < kPerfEventCount; ++e) {
+			if (fds_[e] < 0) continue;
+			uint64_t v[3] = {};
+			if (::read(fds_[e], v, sizeof(v)) != (ssize_t)sizeof(v) || v[2] == 0) continue;
+			s.value[e] = v[2] < v[1] ? (uint64_t)((double)v[0] * v[1] / v[2]) : v[0];
+			s.valid[e] = true;
+		}
+#endif
+		return s;
+	}
+	void start() {
+		reset();
+		enable();
+	}
+	PerfSample stop() {
+		disable();
+		return read();
+	}
+
+private:
+	int fds_[kPerfEventCount];
+};
@@ -0,0 +1,381 @@
+#include "scheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "numa.h"
+
+namespace {
+
+// Ranges shorter than this are not worth a second file handle.
+constexpr uint64_t kMinSplit = 16u << 20;
+constexpr uint64_t kToEof = UINT64_MAX;
+
+// Counts of one byte range of a file. The kernel state is seeded from the
+// bytes before the range, so lines, words, bytes and chars simply add up.
+// The longest line needs the pieces in file order: counts.maxLineLength
+// covers the lines wholly inside the range, head is the length of the line
+// the range starts in (up to and including its '\n') and tail the length
+// after the last '\n'.
+struct Piece {
+	uint64_t offset = 0;
+	Counts counts;
+	bool hasNewline = false;
+	uint64_t head = 0;
+	uint64_t tail = 0;
+};
+
+struct FileJob {
+	std::string path;
+	std::vector<Piece> pieces;
+	Stats stats;
+	PerfSample perf;
+	std::string checksum;
+	std::string error;
+	int pending = 1;
+	bool opened = true;
+	bool skipHead = false;
+	bool done = false;
+};
+
+struct Task {
+	FileJob* job = nullptr;
+	uint64_t begin = 0;
+	uint64_t end = kToEof;
+	bool whole = true;
+};
+
+struct WorkerQueue {
+	std::mutex mutex;
+	std::deque<Task> tasks;
+};
+
+// skipHead drops the line the first piece starts in (--partition slices
+// that start mid-line).
+Counts mergePieces(std::vector<Piece>& pieces, bool countMaxLine, bool skipHead) {
+	std::sort(pieces.begin(), pieces.end(), [](const Piece& a, const Piece& b) { return a.offset < b.offset; });
+	Counts c{};
+	uint64_t open = 0;
+	for (const Piece& p : pieces) {
+		c.lineCount += p.counts.lineCount;
+		c.wordCount += p.counts.wordCount;
+		c.byteCount += p.counts.byteCount;
+		c.charCount += p.counts.charCount;
+		if (!countMaxLine) continue;
+		if (!p.hasNewline) {
+			open += p.tail;
+			continue;
+		}
+		c.maxLineLength = std::max({ c.maxLineLength, skipHead ? 0 : open + p.head, p.counts.maxLineLength });
+		open = p.tail;
+		skipHead = false;
+	}
+	if (skipHead) open = 0;
+	if (countMaxLine) c.maxLineLength = std::max(c.maxLineLength, open);
+	return c;
+}
+
+class Scheduler {
+public:
+	Scheduler(const Options& opt, const KernelInfo& k, unsigned threads)
+		: opt_(opt), kernel_(k), queues_(threads), jobs_(opt.files.size()), topology_(readNumaTopology())
+	{
+		// Workers are spread round-robin over the NUMA nodes and steal from
+		// workers on their own node before going remote.
+		workerNode_.assign(threads, 0);
+		victims_.resize(threads);
+		for (unsigned w = 0; w < threads; ++w) {
+			if (topology_.size()) workerNode_[w] = w % topology_.size();
+			victims_[w].push_back(w);
+			for (int remote = 0; remote < 2; ++remote)
+				for (unsigned i = 1; i < threads; ++i) {
+					unsigned v = (w + i) % threads;
+					if ((workerNode_[v] != workerNode_[w]) == (remote != 0)) victims_[w].push_back(v);
+				}
+		}
+		for (size_t i = 0; i < jobs_.size(); ++i) {
+			jobs_[i].path = opt.files[i];
+			Task t;
+			t.job = &jobs_[i];
+			t.begin = opt.offset;
+			t.end = rangeEnd(opt);
+			queues_[i % threads].tasks.push_back(t);
+		}
+		queued_ = outstanding_ = jobs_.size();
+	}
+
+	void run(const std::function<void(size_t, FileResult&)>& emit) {
+		std::vector<std::thread> workers;
+		for (size_t w = 0; w < queues_.size(); ++w)
+			workers.emplace_back([this, w] { work(w); });
+		for (size_t i = 0; i < jobs_.size(); ++i) {
+			FileJob& job = jobs_[i];
+			{
+				std::unique_lock<std::mutex> lock(resultMutex_);
+				resultCv_.wait(lock, [&] { return job.done; });
+			}
+			FileResult r;
+			r.opened = job.opened;
+			r.counts = mergePieces(job.pieces, opt_.optMaxLine, job.skipHead);
+			r.stats = job.stats;
+			r.perf = job.perf;
+			r.checksum = job.checksum;
+			r.error = job.error;
+			emit(i, r);
+		}
+		for (auto& t : workers) t.join();
+	}
+
+private:
+	void push(size_t w, const Task& t) {
+		outstanding_++;
+		{
+			std::lock_guard<std::mutex> lock(queues_[w].mutex);
+			queues_[w].tasks.push_back(t);
+		}
+		queued_++;
+		std::lock_guard<std::mutex> lock(idleMutex_);
+		idleCv_.notify_one();
+	}
+
+	// Own queue from the front (file order), other queues from the back,
+	// where freshly split ranges land.
+	bool take(size_t self, Task& t) {
+		for (unsigned v : victims_[self]) {
+			WorkerQueue& q = queues_[v];
+			std::lock_guard<std::mutex> lock(q.mutex);
+			if (q.tasks.empty()) continue;
+			if (v == self) {
+				t = q.tasks.front();
+				q.tasks.pop_front();
+			}
+			else {
+				t = q.tasks.back();
+				q.tasks.pop_back();
+			}
+			queued_--;
+			return true;
+		}
+		return false;
+	}
+
+	// Splits go to a worker on the node whose page cache holds the range.
+	size_t placeRange(size_t self, FILE* f, uint64_t begin, uint64_t end) {
+		if (!topology_.size()) return self;
+		int node = fileRangeNode(f, begin, end - begin);
+		for (size_t i = 0; i < topology_.size(); ++i) {
+			if (topology_.nodeIds[i] != node || workerNode_[self] == i) continue;
+			for (size_t n = 0; n < queues_.size(); ++n) {
+				size_t w = (self + n) % queues_.size();
+				if (workerNode_[w] == i) return w;
+			}
+		}
+		return self;
+	}
+
+	void work(size_t self) {
+		// Pin before allocating so the buffer is first touched on the local node.
+		if (topology_.size()) pinThread(topology_.cpus[workerNode_[self]]);
+		std::vector<unsigned char> buffer(opt_.bufSize);
+		std::unique_ptr<PerfCounters> perf;
+		if (opt_.perf) {
+			perf.reset(new PerfCounters());
+			if (!perf->any()) perf.reset();
+		}
+		for (;;) {
+			Task t;
+			if (take(self, t)) {
+				runTask(self, t, buffer, perf.get());
+				if (--outstanding_ == 0) {
+					std::lock_guard<std::mutex> lock(idleMutex_);
+					idleCv_.notify_all();
+				}
+				continue;
+			}
+			if (outstanding_ == 0) return;
+			idle_++;
+			{
+				std::unique_lock<std::mutex> lock(idleMutex_);
+				idleCv_.wait_for(lock, std::chrono::milliseconds(1),
+					[&] { return queued_ > 0 || outstanding_ == 0; });
+			}
+			idle_--;
+		}
+	}
+
+	void processPiece(const unsigned char* buf, size_t n, Piece& piece, KernelState& st) {
+		if (opt_.optMaxLine && !piece.hasNewline) {
+			const void* nl = memchr(buf, '\n', n);
+			if (!nl) {
+				kernel_.process(buf, n, piece.counts, st, opt_.optLines, opt_.optWords, opt_.optBytes, opt_.optChars, true);
+				return;
+			}
+			size_t h = (size_t)((const unsigned char*)nl - buf) + 1;
+			Counts hc{};
+			kernel_.process(buf, h, hc, st, opt_.optLines, opt_.optWords, opt_.optBytes, opt_.optChars, true);
+			piece.head = hc.maxLineLength;
+			piece.hasNewline = true;
+			hc.maxLineLength = 0;
+			addCounts(piece.counts, hc);
+			buf += h;
+			n -= h;
+		}
+		kernel_.process(buf, n, piece.counts, st,
+			opt_.optLines, opt_.optWords, opt_.optBytes, opt_.optChars, opt_.optMaxLine);
+	}
+
+	void runTask(size_t self, const Task& t, std::vector<unsigned char>& buffer, PerfCounters* perf) {
+		FileJob& job = *t.job;
+		Stats stats{};
+		Piece piece;
+		piece.offset = t.begin;
+		Clock::time_point t0 = Clock::now();
+		FILE* f = openInput(job.path);
+		if (job.path != "-") stats.syscalls++;
+		stats.openSec = secondsBetween(t0, Clock::now());
+
+		uint64_t size = 0;
+		bool opened = f != nullptr;
+		bool ok = opened;
+		bool regular = ok && job.path != "-" && regularFileSize(f, size);
+		// A digest needs the bytes in order, so with --checksum files are not split.
+		Checksum sum(opt_.checksum);
+		Checksum* digest = opt_.checksum != Checksum::kNone ? &sum : nullptr;
+		std::string error;
+		if (ok && !regular && t.whole) {
+			if (!countStream(f, kernel_, buffer, opt_, piece.counts, stats, perf, digest)) error = strerror(errno);
+			piece.hasNewline = true;
+		}
+		else if (ok) {
+			if (perf) perf->reset();
+			KernelState st{};
+			// A slice that starts past the end (--partition) reads nothing
+			// here or below and counts as empty.
+			if (!t.whole || (opt_.partition && t.begin > 0)) {
+				unsigned char before[3];
+				size_t k = (size_t)std::min<uint64_t>(t.begin, sizeof(before));
+				ok = seekInput(f, t.begin - k);
+				size_t got = ok ? fread(before, 1, k, f) : 0;
+				ok = ok && !ferror(f);
+				stats.syscalls++;
+				seedState(st, before, got);
+				if (t.whole && got == k && before[k - 1] != '\n') {
+					std::lock_guard<std::mutex> lock(resultMutex_);
+					job.skipHead = true;
+				}
+			}
+			else if (t.begin > 0) {
+				ok = seekInput(f, t.begin);
+				stats.syscalls++;
+			}
+			uint64_t pos = t.begin, end = t.end;
+			bool sparse = isSparse(f);
+			unsigned char last = '\n';
+			Clock::time_point t1 = Clock::now();
+			while (ok && pos < end) {
+				uint64_t known = std::min(end, size);
+				if (idle_ > 0 && !digest && known > pos && known - pos >= 2 * kMinSplit) {
+					Task rest;
+					rest.job = &job;
+					rest.begin = pos + (known - pos) / 2;
+					rest.end = end;
+					rest.whole = false;
+					{
+						std::lock_guard<std::mutex> lock(resultMutex_);
+						job.pending++;
+					}
+					push(placeRange(self, f, rest.begin, known), rest);
+					end = rest.begin;
+				}
+				size_t want = (size_t)std::min<uint64_t>(buffer.size(), end - pos);
+				if (sparse && pos < std::min(end, size)) {
+					Extent e = nextExtent(f, pos, std::min(end, size));
+					stats.syscalls += e.hole ? 2 : 3;
+					if (e.hole) {
+						processZeros(e.length, piece.counts, st, opt_.optWords, opt_.optBytes, opt_.optChars, opt_.optMaxLine);
+						if (digest) digest->updateZeros(e.length);
+						stats.bytes += e.length;
+						pos += e.length;
+						last = 0;
+						seekInput(f, pos);
+						continue;
+					}
+					want = (size_t)std::min<uint64_t>(want, e.length);
+					seekInput(f, pos);
+				}
+				size_t n = fread(buffer.data(), 1, want, f);
+				Clock::time_point t2 = Clock::now();
+				stats.readSec += secondsBetween(t1, t2);
+				stats.reads++;
+				stats.syscalls++;
+				stats.bytes += n;
+				if (n == 0) break;
+				if (perf) perf->enable();
+				processPiece(buffer.data(), n, piece, st);
+				if (perf) perf->disable();
+				if (digest) digest->update(buffer.data(), n);
+				last = buffer[n - 1];
+				pos += n;
+				t1 = Clock::now();
+				stats.kernelSec += secondsBetween(t2, t1);
+			}
+			piece.tail = st.currentLineLen;
+			if (ok && opt_.partition && opt_.optMaxLine && pos == end && end == t.end && t.end == rangeEnd(opt_) && last != '\n')
+				piece.tail = extendLine(f, kernel_, buffer, opt_, st, stats);
+			if (!ok || ferror(f)) error = strerror(errno);
+		}
+		if (f) {
+			closeInput(f);
+			if (job.path != "-") stats.syscalls++;
+		}
+
+		PerfSample ps;
+		if (perf) ps = perf->read();
+		std::lock_guard<std::mutex> lock(resultMutex_);
+		if (!opened) job.opened = false;
+		if (!error.empty()) job.error = error;
+		if (digest) job.checksum = sum.hex();
+		job.pieces.push_back(piece);
+		addStats(job.stats, stats);
+		for (int e = 0; e < kPerfEventCount; ++e) {
+			job.perf.value[e] += ps.value[e];
+			job.perf.valid[e] = job.perf.valid[e] || ps.valid[e];
+		}
+		if (--job.pending == 0) {
+			job.done = true;
+			resultCv_.notify_all();
+		}
+	}
+
+	const Options& opt_;
+	const KernelInfo& kernel_;
+	std::vector<WorkerQueue> queues_;
+	std::vector<FileJob> jobs_;
+	NumaTopology topology_;
+	std::vector<size_t> workerNode_;
+	std::vector<std::vector<unsigned>> victims_;
+	std::atomic<size_t> queued_{ 0 };
+	std::atomic<size_t> outstanding_{ 0 };
+	std::atomic<unsigned> idle_{ 0 };
+	std::mutex idleMutex_;
+	std::condition_variable idleCv_;
+	std::mutex resultMutex_;
+	std::condition_variable resultCv_;
+};
+
+} // namespace
+
+void countFilesParallel(const Options& opt, const KernelInfo& k, unsigned threads,
+	const std::function<void(size_t index, FileResult& r)>& emit)
+{
+	Scheduler s(opt, k, std::max(1u, threads));
+	s.run(emit);
+}
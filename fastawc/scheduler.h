@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+#include "count.h"
+
+// Counts opt.files on `threads` workers and calls emit for every file, in
+// command-line order, on the calling thread. Each worker owns a deque of
+// tasks and idle workers steal from the others. A worker reading a large
+// regular file hands the back half of its remaining range to the queue
+// whenever another worker is idle, so one huge file among many small ones
+// still ends up spread over every worker. Streams are never split.
+void countFilesParallel(const Options& opt, const KernelInfo& k, unsigned threads,
+	const std::function<void(size_t index, FileResult& r)>& emit);
@@ -0,0 +1,326 @@
+#include "serve.h"
+
+#include <iostream>
+
+#ifdef _WIN32
+int runServer(const std::string&, const Options&, const KernelInfo&) {
+	std::cerr << "fastawc: --serve is not supported on this platform\n";
+	return 1;
+}
+#else
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kMaxFdsPerMessage = 64;
+constexpr size_t kRecvSize = 64u << 10;
+// Longest request line and most descriptors queued ahead of their '@'
+// lines; a client going past either is disconnected, which keeps a
+// worker's memory bounded.
+constexpr size_t kMaxLine = 64u << 10;
+constexpr size_t kMaxQueuedFds = 1024;
+// Unparsed input: a partial line plus one receive.
+constexpr size_t kMaxPending = kMaxLine + kRecvSize;
+// The reply batch is sent once it reaches kRecvSize, so it holds at most
+// that plus one reply, which echoes its request line.
+constexpr size_t kMaxReply = kRecvSize + kMaxPending + 256;
+// Per worker: receive buffer, unparsed input and a copy of its current
+// line, reply batch.
+constexpr size_t kConnectionBytes = kRecvSize + 2 * kMaxPending + kMaxReply;
+// Approximate footprint of one cache entry including its hash node and
+// eviction queue slot.
+constexpr size_t kCacheEntryBytes = 120;
+// A connection that sends nothing, or does not read its replies, for this
+// long is closed so that it cannot hold a worker.
+constexpr int kIdleSeconds = 30;
+
+unsigned flagBits(const Options& o) {
+	return (o.optLines ? 1u : 0u) | (o.optWords ? 2u : 0u) | (o.optBytes ? 4u : 0u)
+		| (o.optChars ? 8u : 0u) | (o.optMaxLine ? 16u : 0u);
+}
+
+// Counts of regular files keyed by inode and requested flags, valid while
+// size, mtime and ctime are unchanged. Files modified within the last two
+// seconds are not cached, since a write in the same timestamp tick would
+// go unnoticed. When full, the oldest entry is evicted first.
+class CountCache {
+public:
+	explicit CountCache(size_t capacity) : capacity_(capacity) {}
+	bool find(const struct stat& sb, unsigned flags, Counts& out) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto it = map_.find(Key{ sb.st_dev, sb.st_ino, flags });
+		if (it == map_.end() || !matches(it->second, sb)) return false;
+		out = it->second.counts;
+		return true;
+	}
+	void store(const struct stat& sb, unsigned flags, const Counts& c) {
+		if (capacity_ == 0 || !S_ISREG(sb.st_mode) || time(nullptr) - sb.st_mtime < 2 || time(nullptr) - sb.st_ctime < 2) return;
+		Key key{ sb.st_dev, sb.st_ino, flags };
+		Entry entry{ sb.st_size, sb.st_mtim, sb.st_ctim, c };
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto it = map_.find(key);
+		if (it != map_.end()) {
+			it->second = entry;
+			return;
+		}
+		if (map_.size() >= capacity_) {
+			map_.erase(order_.front());
+			order_.pop_front();
+		}
+		map_.emplace(key, entry);
+		order_.push_back(key);
+	}
+
+private:
+	struct Key {
+		dev_t dev;
+		ino_t ino;
+		unsigned flags;
+		bool operator==(const Key& o) const { return dev == o.dev && ino == o.ino && flags == o.flags; }
+	};
+	struct KeyHash {
+		size_t operator()(const Key& k) const {
+			return std::hash<uint64_t>()((uint64_t)k.ino * 0x9E3779B97F4A7C15ull ^ (uint64_t)k.dev ^ k.flags);
+		}
+	};
+	struct Entry {
+		off_t size;
+		timespec mtime;
+		timespec ctime;
+		Counts counts;
+	};
+	static bool matches(const Entry& e, const struct stat& sb) {
+		return e.size == sb.st_size
+			&& e.mtime.tv_sec == sb.st_mtim.tv_sec && e.mtime.tv_nsec == sb.st_mtim.tv_nsec
+			&& e.ctime.tv_sec == sb.st_ctim.tv_sec && e.ctime.tv_nsec == sb.st_ctim.tv_nsec;
+	}
+
+	size_t capacity_;
+	std::mutex mutex_;
+	std::unordered_map<Key, Entry, KeyHash> map_;
+	std::deque<Key> order_;
+};
+
+struct Worker {
+	const KernelInfo* kernel;
+	CountCache* cache;
+	std::vector<unsigned char> buffer;
+};
+
+char gSocketPath[sizeof(sockaddr_un::sun_path)];
+
+void onTerminate(int) {
+	unlink(gSocketPath);
+	_exit(0);
+}
+
+bool writeAll(int fd, const std::string& s) {
+	size_t off = 0;
+	while (off < s.size()) {
+		ssize_t n = send(fd, s.data() + off, s.size() - off, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		off += (size_t)n;
+	}
+	return true;
+}
+
+bool parseFlags(const std::string& line, Options& opt) {
+	Options o = opt;
+	o.optLines = o.optWords = o.optBytes = o.optChars = o.optMaxLine = false;
+	for (size_t j = 1; j < line.size(); ++j) {
+		char ch = line[j];
+		if (ch == 'l') o.optLines = true;
+		else if (ch == 'w') o.optWords = true;
+		else if (ch == 'c') o.optBytes = true;
+		else if (ch == 'm') o.optChars = true;
+		else if (ch == 'L') o.optMaxLine = true;
+		else return false;
+	}
+	if (!o.optLines && !o.optWords && !o.optBytes && !o.optChars && !o.optMaxLine)
+		o.optLines = o.optWords = o.optBytes = true;
+	opt = o;
+	return true;
+}
+
+std::string countDescriptor(Worker& w, int fd, const std::string& label, const Options& opt) {
+	struct stat sb;
+	bool haveStat = fstat(fd, &sb) == 0;
+	Counts c{};
+	if (haveStat && w.cache->find(sb, flagBits(opt), c)) {
+		close(fd);
+		return formatCounts(c, &label, opt);
+	}
+	// A passed descriptor shares its offset with the client. Regular files
+	// are counted from the start, unbuffered so that fclose has no
+	// read-ahead to seek back over, and the offset is then put back.
+	// Anything else is read from where it is.
+	off_t saved = haveStat && S_ISREG(sb.st_mode) ? lseek(fd, 0, SEEK_CUR) : -1;
+	FILE* f = fdopen(fd, "rb");
+	if (!f) {
+		close(fd);
+		return "fastawc: cannot read " + label + "\n";
+	}
+	if (saved >= 0) {
+		setvbuf(f, nullptr, _IONBF, 0);
+		lseek(fd, 0, SEEK_SET);
+	}
+	Stats stats{};
+	bool ok = countStream(f, *w.kernel, w.buffer, opt, c, stats);
+	int err = errno;
+	if (saved >= 0) lseek(fd, saved, SEEK_SET);
+	fclose(f);
+	if (!ok) return "fastawc: " + label + ": " + strerror(err) + "\n";
+	if (haveStat) w.cache->store(sb, flagBits(opt), c);
+	return formatCounts(c, &label, opt);
+}
+
+// Line protocol: "-FLAGS" sets the flags for following requests, "@LABEL"
+// counts the next descriptor passed with SCM_RIGHTS, an empty line is
+// echoed back to mark the end of a batch, anything else is a path.
+void serveConnection(Worker& w, int conn, const Options& base) {
+	Options opt = base;
+	std::string pending, out;
+	std::deque<int> fds;
+	std::vector<char> data(kRecvSize);
+	alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kMaxFdsPerMessage)];
+	for (;;) {
+		iovec iov{ data.data(), data.size() };
+		msghdr msg{};
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		ssize_t n = recvmsg(conn, &msg, MSG_CMSG_CLOEXEC);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) break;
+		for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+			if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS) continue;
+			size_t count = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+			for (size_t i = 0; i < count; ++i) {
+				int fd;
+				memcpy(&fd, CMSG_DATA(cm) + i * sizeof(int), sizeof(int));
+				if (fds.size() < kMaxQueuedFds) fds.push_back(fd);
+				else close(fd);
+			}
+		}
+		pending.append(data.data(), (size_t)n);
+
+		size_t start = 0, nl;
+		bool sent = true;
+		while ((nl = pending.find('\n', start)) != std::string::npos) {
+			if (out.size() >= kRecvSize) {
+				if (!(sent = writeAll(conn, out))) break;
+				out.clear();
+			}
+			std::string line = pending.substr(start, nl - start);
+			start = nl + 1;
+			if (!line.empty() && line.back() == '\r') line.pop_back();
+			if (line.empty()) {
+				out += "\n";
+			}
+			else if (line[0] == '-' && line.size() > 1) {
+				if (!parseFlags(line, opt)) out += "fastawc: bad flags " + line + "\n";
+			}
+			else if (line[0] == '@') {
+				if (fds.empty()) {
+					out += "fastawc: no descriptor for " + line + "\n";
+					continue;
+				}
+				int fd = fds.front();
+				fds.pop_front();
+				out += countDescriptor(w, fd, line.substr(1), opt);
+			}
+			else {
+				int fd = open(line.c_str(), O_RDONLY | O_CLOEXEC);
+				if (fd < 0) out += "fastawc: cannot open " + line + "\n";
+				else out += countDescriptor(w, fd, line, opt);
+			}
+		}
+		if (!sent) break;
+		pending.erase(0, start);
+		if (pending.size() > kMaxLine) out += "fastawc: request line too long\n";
+		if (!out.empty() && !writeAll(conn, out)) break;
+		if (pending.size() > kMaxLine) break;
+		out.clear();
+	}
+	for (int fd : fds) close(fd);
+}
+
+} // namespace
+
+int runServer(const std::string& socketPath, const Options& cliOpt, const KernelInfo& kernel) {
+	Options opt = cliOpt;
+	applyMemoryBudget(opt, opt.threads ? opt.threads : std::max(1u, std::thread::hardware_concurrency()),
+		kConnectionBytes, kCacheEntryBytes);
+	if (socketPath.size() >= sizeof(gSocketPath)) {
+		std::cerr << "fastawc: socket path too long: " << socketPath << "\n";
+		return 1;
+	}
+	sockaddr_un addr{};
+	addr.sun_family = AF_UNIX;
+	memcpy(addr.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+	struct stat sb;
+	if (lstat(socketPath.c_str(), &sb) == 0) {
+		int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		bool live = S_ISSOCK(sb.st_mode) && connect(probe, (sockaddr*)&addr, sizeof(addr)) == 0;
+		close(probe);
+		if (!S_ISSOCK(sb.st_mode) || live) {
+			std::cerr << "fastawc: " << socketPath << " is in use\n";
+			return 1;
+		}
+		unlink(socketPath.c_str());
+	}
+
+	int lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (lfd < 0 || bind(lfd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(lfd, SOMAXCONN) != 0) {
+		std::cerr << "fastawc: cannot listen on " << socketPath << ": " << strerror(errno) << "\n";
+		return 1;
+	}
+	memcpy(gSocketPath, socketPath.c_str(), socketPath.size() + 1);
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGINT, onTerminate);
+	signal(SIGTERM, onTerminate);
+
+	CountCache cache(opt.cacheEntries);
+	unsigned workers = opt.threads;
+	std::vector<std::thread> threads;
+	for (unsigned i = 0; i < workers; ++i) {
+		threads.emplace_back([&] {
+			Worker w{ &kernel, &cache, std::vector<unsigned char>(opt.bufSize) };
+			for (;;) {
+				int conn = accept4(lfd, nullptr, nullptr, SOCK_CLOEXEC);
+				if (conn < 0) {
+					if (errno == EINTR || errno == ECONNABORTED) continue;
+					std::cerr << "fastawc: accept: " << strerror(errno) << "\n";
+					return;
+				}
+				timeval idle{ kIdleSeconds, 0 };
+				setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &idle, sizeof(idle));
+				setsockopt(conn, SOL_SOCKET, SO_SNDTIMEO, &idle, sizeof(idle));
+				serveConnection(w, conn, opt);
+				close(conn);
+			}
+		});
+	}
+	std::cerr << "fastawc: serving on " << socketPath << " with " << workers << " workers\n";
+	for (auto& t : threads) t.join();
+	unlink(socketPath.c_str());
+	return 1;
+}
+#endif
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+
+#include "count.h"
+
+// Long-lived daemon mode: listens on a Unix domain socket and answers
+// batches of count requests, keeping worker buffers and a count cache warm
+// between clients. See README for the protocol.
+int runServer(const std::string& socketPath, const Options& opt, const KernelInfo& kernel);
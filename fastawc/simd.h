@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// Fixed-width vector instruction sets behind one interface, so each counter
+// in kernels.h is written once and instantiated per ISA. A compare gives a
+// Mask with one bit per byte lane, lane i at bit kLaneBits * i, and kAll
+// has the bit of every lane set. Per ISA:
+//   load(p)          kWidth bytes, unaligned
+//   loadShort(p, n)  n < kWidth bytes, zero above, never reading past p + n
+//   eq(v, c)         lanes equal to c
+//   le(v, c)         lanes <= c, unsigned
+//   sub(v, c), andb(v, c)  bytewise, for range tests and bit-field compares
+// Translation units built for several ISAs see the struct of each; the
+// kernels pick theirs.
+
+static inline uint32_t popcnt64(uint64_t x) {
+#if defined(_MSC_VER) && defined(_M_X64)
+	return (uint32_t)__popcnt64(x);
+#elif defined(_MSC_VER)
+	return __popcnt((uint32_t)x) + __popcnt((uint32_t)(x >> 32));
+#elif defined(__x86_64__) && !defined(__POPCNT__)
+	// Baseline x86-64 has no popcnt, and the builtin would be a library call.
+	x -= (x >> 1) & 0x5555555555555555ull;
+	x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+	x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+	return (uint32_t)((x * 0x0101010101010101ull) >> 56);
+#else
+	return (uint32_t)__builtin_popcountll(x);
+#endif
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+struct Sse2 {
+	using Reg = __m128i;
+	using Mask = uint32_t;
+	static constexpr const char* kName = "sse2";
+	static constexpr size_t kWidth = 16;
+	static constexpr int kLaneBits = 1;
+	static constexpr Mask kAll = 0xFFFF;
+
+	static Reg load(const unsigned char* p) { return _mm_loadu_si128((const __m128i*)p); }
+	static Reg loadShort(const unsigned char* p, size_t n) {
+		alignas(16) unsigned char padded[16] = {};
+		memcpy(padded, p, n);
+		return _mm_load_si128((const __m128i*)padded);
+	}
+	static Reg set1(unsigned char c) { return _mm_set1_epi8((char)c); }
+	static Mask eq(Reg v, unsigned char c) { return (Mask)_mm_movemask_epi8(_mm_cmpeq_epi8(v, set1(c))); }
+	static Mask le(Reg v, unsigned char c) { return (Mask)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(v, set1(c)), v)); }
+	static Reg sub(Reg v, unsigned char c) { return _mm_sub_epi8(v, set1(c)); }
+	static Reg andb(Reg v, unsigned char c) { return _mm_and_si128(v, set1(c)); }
+};
+#endif
+
+#ifdef __AVX2__
+struct Avx2 {
+	using Reg = __m256i;
+	using Mask = uint32_t;
+	static constexpr const char* kName = "avx2";
+	static constexpr size_t kWidth = 32;
+	static constexpr int kLaneBits = 1;
+	static constexpr Mask kAll = 0xFFFFFFFFu;
+
+	static Reg load(const unsigned char* p) { return _mm256_loadu_si256((const __m256i*)p); }
+	static Reg loadShort(const unsigned char* p, size_t n) {
+#if defined(__AVX512BW__) && defined(__AVX512VL__)
+		return _mm256_maskz_loadu_epi8((__mmask32)((1u << n) - 1), p);
+#else
+		alignas(32) unsigned char padded[32] = {};
+		memcpy(padded, p, n);
+		return _mm256_load_si256((const __m256i*)padded);
+#endif
+	}
+	static Reg set1(unsigned char c) { return _mm256_set1_epi8((char)c); }
+	static Mask eq(Reg v, unsigned char c) { return (Mask)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, set1(c))); }
+	static Mask le(Reg v, unsigned char c) { return (Mask)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(v, set1(c)), v)); }
+	static Reg sub(Reg v, unsigned char c) { return _mm256_sub_epi8(v, set1(c)); }
+	static Reg andb(Reg v, unsigned char c) { return _mm256_and_si256(v, set1(c)); }
+};
+#endif
+
+#ifdef __AVX512BW__
+struct Avx512 {
+	using Reg = __m512i;
+	using Mask = uint64_t;
+	static constexpr const char* kName = "avx512";
+	static constexpr size_t kWidth = 64;
+	static constexpr int kLaneBits = 1;
+	static constexpr Mask kAll = ~0ull;
+
+	static Reg load(const unsigned char* p) { return _mm512_loadu_si512((const void*)p); }
+	static Reg loadShort(const unsigned char* p, size_t n) {
+		return _mm512_maskz_loadu_epi8((__mmask64)((1ull << n) - 1), p);
+	}
+	static Reg set1(unsigned char c) { return _mm512_set1_epi8((char)c); }
+	static Mask eq(Reg v, unsigned char c) { return _mm512_cmpeq_epi8_mask(v, set1(c)); }
+	static Mask le(Reg v, unsigned char c) { return _mm512_cmple_epu8_mask(v, set1(c)); }
+	static Reg sub(Reg v, unsigned char c) { return _mm512_sub_epi8(v, set1(c)); }
+	static Reg andb(Reg v, unsigned char c) { return _mm512_and_si512(v, set1(c)); }
+};
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+// No movemask: narrowing each 16-bit pair by four bits leaves a nibble per
+// byte, of which the lowest bit is kept.
+struct Neon {
+	using Reg = uint8x16_t;
+	using Mask = uint64_t;
+	static constexpr const char* kName = "neon";
+	static constexpr size_t kWidth = 16;
+	static constexpr int kLaneBits = 4;
+	static constexpr Mask kAll = 0x1111111111111111ull;
+
+	static Reg load(const unsigned char* p) { return vld1q_u8(p); }
+	static Reg loadShort(const unsigned char* p, size_t n) {
+		unsigned char padded[16] = {};
+		memcpy(padded, p, n);
+		return vld1q_u8(padded);
+	}
+	static Mask movemask(Reg m) {
+		uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(m), 4);
+		return vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & kAll;
+	}
+	static Mask eq(Reg v, unsigned char c) { return movemask(vceqq_u8(v, vdupq_n_u8(c))); }
+	static Mask le(Reg v, unsigned char c) { return movemask(vcleq_u8(v, vdupq_n_u8(c))); }
+	static Reg sub(Reg v, unsigned char c) { return vsubq_u8(v, vdupq_n_u8(c)); }
+	static Reg andb(Reg v, unsigned char c) { return vandq_u8(v, vdupq_n_u8(c)); }
+};
+#endif
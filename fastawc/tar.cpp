@@ -0,0 +1,142 @@
+#include "archive.h"
+
+#include <cstring>
+
+#include "decompress.h"
+
+namespace {
+
+constexpr size_t kBlock = 512;
+// GNU long names and pax records are held in memory whole; real ones are a
+// few hundred bytes, so anything larger is taken as a corrupt header.
+constexpr uint64_t kMaxExtHeader = 1u << 20;
+
+// Octal, or GNU base-256 when the high bit of the first byte is set.
+uint64_t parseNumber(const unsigned char* p, size_t n) {
+	uint64_t v = 0;
+	if (p[0] & 0x80) {
+		v = p[0] & 0x3F;
+		for (size_t i = 1; i < n; ++i) v = (v << 8) | p[i];
+		return v;
+	}
+	size_t i = 0;
+	while (i < n && (p[i] == ' ' || p[i] == 0)) ++i;
+	for (; i < n && p[i] >= '0' && p[i] <= '7'; ++i) v = (v << 3) | (uint64_t)(p[i] - '0');
+	return v;
+}
+
+std::string field(const unsigned char* p, size_t n) {
+	size_t len = 0;
+	while (len < n && p[len]) ++len;
+	return std::string((const char*)p, len);
+}
+
+bool checksumOk(const unsigned char* h) {
+	uint64_t want = parseNumber(h + 148, 8);
+	uint64_t sum = 0;
+	int64_t ssum = 0;
+	for (size_t i = 0; i < kBlock; ++i) {
+		unsigned char c = (i >= 148 && i < 156) ? ' ' : h[i];
+		sum += c;
+		ssum += (signed char)c;
+	}
+	return sum == want || (uint64_t)ssum == want;
+}
+
+// "LEN key=value\n" records of a pax extended header.
+void parsePax(const std::string& data, std::string& path, uint64_t& size, bool& haveSize) {
+	size_t pos = 0;
+	while (pos < data.size()) {
+		size_t sp = data.find(' ', pos);
+		if (sp == std::string::npos) break;
+		size_t len = (size_t)strtoull(data.c_str() + pos, nullptr, 10);
+		if (len == 0 || pos + len > data.size()) break;
+		std::string rec = data.substr(sp + 1, pos + len - sp - 2);
+		size_t eq = rec.find('=');
+		if (eq != std::string::npos) {
+			std::string key = rec.substr(0, eq);
+			if (key == "path") path = rec.substr(eq + 1);
+			else if (key == "size") {
+				size = strtoull(rec.c_str() + eq + 1, nullptr, 10);
+				haveSize = true;
+			}
+		}
+		pos += len;
+	}
+}
+
+} // namespace
+
+size_t tarZstdWindow(const Options& opt) {
+	if (opt.maxMemory == 0) return 0;
+	size_t window = 1u << 20;
+	while (window < (128u << 20) && (uint64_t)window * 2 <= opt.maxMemory / 4) window *= 2;
+	return window;
+}
+
+size_t tarExtraBytes(const Options& opt) {
+	// An extended header, the record being parsed and the name kept from it.
+	return StreamReader::memoryBytes(StreamReader::kAuto, tarZstdWindow(opt)) + 3 * kMaxExtHeader;
+}
+
+std::string countTar(FILE* f, const std::string& label, const KernelInfo& k,
+	std::vector<unsigned char>& buffer, const Options& opt, PerfCounters* perf, const MemberFn& emit)
+{
+	StreamReader in(f, StreamReader::kAuto, UINT64_MAX, tarZstdWindow(opt));
+	if (!in.error().empty()) return in.error();
+	unsigned char h[kBlock];
+	std::string longName, paxPath;
+	uint64_t paxSize = 0;
+	bool havePaxSize = false;
+	bool first = true;
+	int zeroBlocks = 0;
+	for (;;) {
+		size_t got = in.read(h, kBlock);
+		if (!in.error().empty()) return in.error();
+		if (got == 0) return first ? "not a tar archive" : "";
+		if (got < kBlock) return first ? "not a tar archive" : "truncated tar archive";
+		bool zero = true;
+		for (unsigned char c : h) zero = zero && c == 0;
+		if (zero) {
+			if (++zeroBlocks == 2) return "";
+			continue;
+		}
+		zeroBlocks = 0;
+		if (!checksumOk(h)) return first ? "not a tar archive" : "corrupt tar header";
+		first = false;
+
+		std::string name = field(h, 100);
+		// POSIX ustar splits long names into prefix/name; GNU ("ustar  ")
+		// keeps other data in that area.
+		if (memcmp(h + 257, "ustar\0", 6) == 0 && h[345]) name = field(h + 345, 155) + "/" + name;
+		uint64_t size = parseNumber(h + 124, 12);
+		char type = (char)h[156];
+		uint64_t padding = (kBlock - size % kBlock) % kBlock;
+
+		if (type == 'L' || type == 'x') {
+			if (size > kMaxExtHeader) return "corrupt tar header";
+			std::string data((size_t)size, '\0');
+			if (size && !in.readFull((unsigned char*)&data[0], (size_t)size)) return "truncated tar archive";
+			if (!in.skip(padding, buffer)) return "truncated tar archive";
+			if (type == 'L') longName = field((const unsigned char*)data.data(), data.size());
+			else parsePax(data, paxPath, paxSize, havePaxSize);
+			continue;
+		}
+		if (!longName.empty()) name = longName;
+		if (!paxPath.empty()) name = paxPath;
+		if (havePaxSize) size = paxSize, padding = (kBlock - size % kBlock) % kBlock;
+		longName.clear();
+		paxPath.clear();
+		havePaxSize = false;
+
+		if (type != '0' && type != '\0' && type != '7') {
+			if (!in.skip(size + padding, buffer)) return "truncated tar archive";
+			continue;
+		}
+		FileResult r;
+		countReader(in, size, k, buffer, opt, r, perf);
+		if (!r.opened) return in.error().empty() ? "truncated tar archive" : in.error();
+		emit(label == "-" ? name : label + ":" + name, r);
+		if (!in.skip(padding, buffer)) return "truncated tar archive";
+	}
+}
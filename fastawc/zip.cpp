@@ -0,0 +1,207 @@
+#include "archive.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "decompress.h"
+
+namespace {
+
+constexpr uint32_t kEndSig = 0x06054b50;
+constexpr uint32_t kEnd64Sig = 0x06064b50;
+constexpr uint32_t kLocator64Sig = 0x07064b50;
+constexpr uint32_t kCentralSig = 0x02014b50;
+constexpr uint32_t kLocalSig = 0x04034b50;
+constexpr size_t kEndSize = 22;
+constexpr size_t kMaxComment = 0xFFFF;
+
+uint16_t le16(const unsigned char* p) { return (uint16_t)(p[0] | p[1] << 8); }
+uint32_t le32(const unsigned char* p) { return (uint32_t)le16(p) | (uint32_t)le16(p + 2) << 16; }
+uint64_t le64(const unsigned char* p) { return (uint64_t)le32(p) | (uint64_t)le32(p + 4) << 32; }
+
+struct Member {
+	std::string name;
+	uint16_t flags = 0;
+	uint16_t method = 0;
+	uint64_t compressed = 0;
+	uint64_t size = 0;
+	uint64_t localOffset = 0;
+};
+
+struct MemberResult {
+	FileResult r;
+	std::string error;
+	bool done = false;
+};
+
+bool readAt(FILE* f, uint64_t offset, unsigned char* dst, size_t n) {
+	return seekInput(f, offset) && fread(dst, 1, n, f) == n;
+}
+
+// Central directory location from the end record, or its zip64 successor
+// when a zip64 locator sits just before it.
+std::string findDirectory(FILE* f, uint64_t fileSize, uint64_t& count, uint64_t& offset, uint64_t& size) {
+	if (fileSize < kEndSize) return "not a zip archive";
+	size_t tailLen = (size_t)std::min<uint64_t>(fileSize, kEndSize + kMaxComment);
+	uint64_t tailStart = fileSize - tailLen;
+	std::vector<unsigned char> tail(tailLen);
+	if (!readAt(f, tailStart, tail.data(), tailLen)) return "cannot read zip end record";
+	size_t pos = tailLen - kEndSize + 1;
+	const unsigned char* end = nullptr;
+	while (pos-- > 0) {
+		if (le32(&tail[pos]) == kEndSig) {
+			end = &tail[pos];
+			break;
+		}
+	}
+	if (!end) return "not a zip archive";
+	count = le16(end + 10);
+	size = le32(end + 12);
+	offset = le32(end + 16);
+	uint64_t endOffset = tailStart + pos;
+	unsigned char locator[20], end64[56];
+	if (endOffset >= sizeof(locator) && readAt(f, endOffset - sizeof(locator), locator, sizeof(locator))
+		&& le32(locator) == kLocator64Sig)
+	{
+		if (!readAt(f, le64(locator + 8), end64, sizeof(end64)) || le32(end64) != kEnd64Sig)
+			return "corrupt zip64 end record";
+		count = le64(end64 + 32);
+		size = le64(end64 + 40);
+		offset = le64(end64 + 48);
+	}
+	if (offset > fileSize || size > fileSize - offset) return "corrupt zip central directory";
+	return "";
+}
+
+std::string readDirectory(FILE* f, uint64_t count, uint64_t offset, uint64_t size, std::vector<Member>& members) {
+	std::vector<unsigned char> dir((size_t)size);
+	if (size && !readAt(f, offset, dir.data(), dir.size())) return "cannot read zip central directory";
+	size_t pos = 0;
+	for (uint64_t i = 0; i < count; ++i) {
+		if (pos + 46 > dir.size() || le32(&dir[pos]) != kCentralSig) return "corrupt zip central directory";
+		const unsigned char* e = &dir[pos];
+		size_t nameLen = le16(e + 28), extraLen = le16(e + 30), commentLen = le16(e + 32);
+		if (pos + 46 + nameLen + extraLen + commentLen > dir.size()) return "corrupt zip central directory";
+		Member m;
+		m.flags = le16(e + 8);
+		m.method = le16(e + 10);
+		m.compressed = le32(e + 20);
+		m.size = le32(e + 24);
+		m.localOffset = le32(e + 42);
+		m.name.assign((const char*)e + 46, nameLen);
+		// The zip64 extra field holds, in this order, the fields saturated above.
+		const unsigned char* x = e + 46 + nameLen;
+		for (size_t xp = 0; xp + 4 <= extraLen;) {
+			size_t id = le16(x + xp), len = le16(x + xp + 2);
+			if (xp + 4 + len > extraLen) break;
+			if (id == 0x0001) {
+				const unsigned char* v = x + xp + 4;
+				const unsigned char* vEnd = v + len;
+				if (m.size == 0xFFFFFFFF && v + 8 <= vEnd) m.size = le64(v), v += 8;
+				if (m.compressed == 0xFFFFFFFF && v + 8 <= vEnd) m.compressed = le64(v), v += 8;
+				if (m.localOffset == 0xFFFFFFFF && v + 8 <= vEnd) m.localOffset = le64(v);
+			}
+			xp += 4 + len;
+		}
+		pos += 46 + nameLen + extraLen + commentLen;
+		if (!m.name.empty() && m.name.back() == '/') continue;
+		members.push_back(m);
+	}
+	return "";
+}
+
+void countMember(FILE* f, const Member& m, const KernelInfo& k, std::vector<unsigned char>& buffer,
+	const Options& opt, PerfCounters* perf, MemberResult& out)
+{
+	if (m.flags & 1) {
+		out.error = "encrypted member";
+		return;
+	}
+	if (m.method != 0 && m.method != 8) {
+		out.error = "unsupported compression method " + std::to_string(m.method);
+		return;
+	}
+	unsigned char local[30];
+	if (!readAt(f, m.localOffset, local, sizeof(local)) || le32(local) != kLocalSig) {
+		out.error = "corrupt local header";
+		return;
+	}
+	if (!seekInput(f, m.localOffset + sizeof(local) + le16(local + 26) + le16(local + 28))) {
+		out.error = "cannot seek to member data";
+		return;
+	}
+	out.r.stats.syscalls += 2;
+	StreamReader in(f, m.method == 0 ? StreamReader::kPlain : StreamReader::kDeflateRaw, m.compressed);
+	if (!in.error().empty()) {
+		out.error = in.error();
+		return;
+	}
+	countReader(in, m.size, k, buffer, opt, out.r, perf);
+	if (!out.r.opened) out.error = in.error().empty() ? "truncated member" : in.error();
+}
+
+} // namespace
+
+size_t zipWorkerExtraBytes() {
+	return StreamReader::memoryBytes(StreamReader::kDeflateRaw, 0);
+}
+
+std::string countZip(const std::string& path, const KernelInfo& k, const Options& opt, const MemberFn& emit) {
+	FILE* f = openInput(path);
+	if (!f) return "cannot open";
+	uint64_t fileSize = 0, count = 0, dirOffset = 0, dirSize = 0;
+	std::vector<Member> members;
+	std::string err = path == "-" || !regularFileSize(f, fileSize) ? "zip archives must be seekable files"
+		: findDirectory(f, fileSize, count, dirOffset, dirSize);
+	if (err.empty()) err = readDirectory(f, count, dirOffset, dirSize, members);
+	closeInput(f);
+	if (!err.empty()) return err;
+
+	// Members are independent, so workers simply take the next one; results
+	// are emitted here in directory order as they complete.
+	std::vector<MemberResult> results(members.size());
+	std::atomic<size_t> next{ 0 };
+	std::mutex mutex;
+	std::condition_variable cv;
+	auto work = [&] {
+		FILE* wf = openInput(path);
+		std::vector<unsigned char> buffer(opt.bufSize);
+		std::unique_ptr<PerfCounters> perf;
+		if (opt.perf) {
+			perf.reset(new PerfCounters());
+			if (!perf->any()) perf.reset();
+		}
+		for (size_t i; (i = next++) < members.size();) {
+			MemberResult res;
+			if (wf) countMember(wf, members[i], k, buffer, opt, perf.get(), res);
+			else res.error = "cannot open";
+			std::lock_guard<std::mutex> lock(mutex);
+			results[i] = std::move(res);
+			results[i].done = true;
+			cv.notify_all();
+		}
+		if (wf) closeInput(wf);
+	};
+	size_t threads = std::min<size_t>(std::max(1u, opt.threads), members.size());
+	std::vector<std::thread> workers;
+	for (size_t w = 0; w < threads; ++w) workers.emplace_back(work);
+	for (size_t i = 0; i < members.size(); ++i) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [&] { return results[i].done; });
+		}
+		std::string label = path + ":" + members[i].name;
+		if (results[i].error.empty()) emit(label, results[i].r);
+		else std::cerr << "fastawc: " << label << ": " << results[i].error << "\n";
+	}
+	for (auto& t : workers) t.join();
+	size_t failed = 0;
+	for (const auto& res : results) failed += !res.error.empty();
+	if (failed) return std::to_string(failed) + (failed == 1 ? " member" : " members") + " could not be counted";
+	return "";
+}
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../fastawc/dispatch.h"
+
+// Differential fuzzer: every kernel in the dispatch table that this CPU
+// supports must produce exactly the Counts and UTF-8 carry of a single
+// processScalar pass, whatever the flags and however the input is split
+// into buffers or into independently seeded chunks, and with all-zero
+// buffers counted arithmetically as sparse-file holes are; kernels that
+// interleave streams must also count pieces of it side by side as each
+// alone. Build with -DFASTAWC_LIBFUZZER and -fsanitize=fuzzer for
+// libFuzzer, otherwise a standalone random driver (which also replays
+// corpus files given on the command line) is built.
+
+struct Flags {
+	bool lines, words, bytes, chars, maxLine;
+};
+
+struct Result {
+	Counts counts;
+	Utf8Carry carry;
+};
+
+// Streams the segments through one state, or with independent=true counts
+// each segment with a fresh state seeded from the bytes before it (the
+// threaded/chunked layout) and sums the results.
+template <class Process, class Finalize>
+static Result runSegments(const unsigned char* buf, const std::vector<size_t>& splits, const Flags& f,
+	bool independent, Process process, Finalize finalize)
+{
+	Result r;
+	KernelState st{};
+	for (size_t i = 0; i + 1 < splits.size(); ++i) {
+		if (!independent) {
+			process(buf + splits[i], splits[i + 1] - splits[i], r.counts, st,
+				f.lines, f.words, f.bytes, f.chars, f.maxLine);
+			continue;
+		}
+		Counts c{};
+		seedState(st, buf, splits[i]);
+		process(buf + splits[i], splits[i + 1] - splits[i], c, st,
+			f.lines, f.words, f.bytes, f.chars, false);
+		r.counts.lineCount += c.lineCount;
+		r.counts.wordCount += c.wordCount;
+		r.counts.byteCount += c.byteCount;
+		r.counts.charCount += c.charCount;
+	}
+	if (!independent) finalize(r.counts, st, f.maxLine);
+	r.carry = st.carry;
+	return r;
+}
+
+static std::vector<const KernelInfo*> gKernels;
+
+static bool sameCarry(const Utf8Carry& a, const Utf8Carry& b) {
+	return a.len == b.len && a.need == b.need && memcmp(a.bytes, b.bytes, a.len) == 0;
+}
+
+static bool sameCounts(const Counts& a, const Counts& b) {
+	return a.lineCount == b.lineCount && a.wordCount == b.wordCount && a.byteCount == b.byteCount
+		&& a.charCount == b.charCount && a.maxLineLength == b.maxLineLength;
+}
+
+static void dumpCounts(const char* what, const Counts& c) {
+	fprintf(stderr, "  %-10s lines %llu words %llu bytes %llu chars %llu maxline %llu\n", what,
+		(unsigned long long)c.lineCount, (unsigned long long)c.wordCount, (unsigned long long)c.byteCount,
+		(unsigned long long)c.charCount, (unsigned long long)c.maxLineLength);
+}
+
+static uint64_t splitmix(uint64_t& s) {
+	uint64_t z = (s += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+// The first input byte selects the flags and the misalignment, the next
+// eight seed the split points; the rest is the text.
+static void checkInput(const uint8_t* data, size_t size) {
+	if (size < 9) return;
+	Flags f{ (data[0] & 1) != 0, (data[0] & 2) != 0, (data[0] & 4) != 0, (data[0] & 8) != 0, (data[0] & 16) != 0 };
+	size_t misalign = (data[0] >> 5) * 4;
+	uint64_t seed;
+	memcpy(&seed, data + 1, 8);
+	data += 9;
+	size -= 9;
+
+	std::vector<unsigned char> storage(size + 64);
+	unsigned char* buf = storage.data() + misalign;
+	if (size) memcpy(buf, data, size);
+
+	std::vector<size_t> whole = { 0, size };
+	Result ref = runSegments(buf, whole, f, false, processScalar, finalizeScalar);
+	Counts refNoMax = ref.counts;
+	refNoMax.maxLineLength = 0;
+
+	std::vector<size_t> splits = { 0 };
+	while (splits.back() < size) {
+		uint64_t r = splitmix(seed);
+		size_t step = (r & 3) == 0 ? 1 + (size_t)(r >> 8) % 3 : 1 + (size_t)(r >> 8) % 97;
+		splits.push_back(std::min(size, splits.back() + step));
+	}
+	if (splits.size() == 1) splits.push_back(0);
+
+	for (const KernelInfo* k : gKernels) {
+		// Mode 3 counts all-zero segments with processZeros, as for holes.
+		auto holes = [k](const unsigned char* p, size_t n, Counts& c, KernelState& st,
+			bool l, bool w, bool b, bool ch, bool L)
+		{
+			if (n && std::all_of(p, p + n, [](unsigned char x) { return x == 0; })) processZeros(n, c, st, w, b, ch, L);
+			else k->process(p, n, c, st, l, w, b, ch, L);
+		};
+		for (int mode = 0; mode < 4; ++mode) {
+			const std::vector<size_t>& sp = mode == 0 ? whole : splits;
+			bool independent = mode == 2;
+			Result got = mode == 3 ? runSegments(buf, sp, f, false, holes, k->finalize)
+				: runSegments(buf, sp, f, independent, k->process, k->finalize);
+			const Counts& want = independent ? refNoMax : ref.counts;
+			bool countsOk = sameCounts(want, got.counts);
+			if (countsOk && sameCarry(ref.carry, got.carry)) continue;
+			fprintf(stderr, "fuzz_kernels: %s diverges%s (flags %s%s%s%s%s, %zu bytes, %zu %s, misalign %zu)\n",
+				k->name, countsOk ? " in UTF-8 carry" : "",
+				f.lines ? "l" : "", f.words ? "w" : "", f.bytes ? "c" : "", f.chars ? "m" : "", f.maxLine ? "L" : "",
+				size, sp.size() - 1, independent ? "chunks" : mode == 3 ? "buffers with holes" : "buffers", misalign);
+			dumpCounts("scalar", want);
+			dumpCounts(k->name, got.counts);
+			abort();
+		}
+		if (!k->processStreams) continue;
+		// The text cut into up to kMaxStreams independent streams, as small
+		// files counted together.
+		size_t cuts[kMaxStreams + 1];
+		size_t streams = 1 + (size_t)splitmix(seed) % kMaxStreams;
+		cuts[0] = 0;
+		cuts[streams] = size;
+		for (size_t s = 1; s < streams; ++s) cuts[s] = (size_t)(splitmix(seed) % (size + 1));
+		std::sort(cuts, cuts + streams + 1);
+		const unsigned char* bufs[kMaxStreams];
+		size_t ns[kMaxStreams];
+		Counts counts[kMaxStreams];
+		KernelState states[kMaxStreams];
+		for (size_t s = 0; s < streams; ++s) {
+			bufs[s] = buf + cuts[s];
+			ns[s] = cuts[s + 1] - cuts[s];
+		}
+		k->processStreams(bufs, ns, streams, counts, states, f.lines, f.words, f.bytes, f.chars, f.maxLine);
+		for (size_t s = 0; s < streams; ++s) {
+			k->finalize(counts[s], states[s], f.maxLine);
+			std::vector<size_t> one = { 0, ns[s] };
+			Result want = runSegments(bufs[s], one, f, false, processScalar, finalizeScalar);
+			bool countsOk = sameCounts(want.counts, counts[s]);
+			if (countsOk && sameCarry(want.carry, states[s].carry)) continue;
+			fprintf(stderr, "fuzz_kernels: %s diverges%s in stream %zu of %zu (flags %s%s%s%s%s, %zu bytes, misalign %zu)\n",
+				k->name, countsOk ? " in UTF-8 carry" : "", s, streams,
+				f.lines ? "l" : "", f.words ? "w" : "", f.bytes ? "c" : "", f.chars ? "m" : "", f.maxLine ? "L" : "",
+				ns[s], misalign);
+			dumpCounts("scalar", want.counts);
+			dumpCounts(k->name, counts[s]);
+			abort();
+		}
+	}
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	static bool init = [] {
+		initSpaceTable();
+		for (const KernelInfo* k : allKernels())
+			if (k->supported()) gKernels.push_back(k);
+		return true;
+	}();
+	(void)init;
+	checkInput(data, size);
+	return 0;
+}
+
+#ifndef FASTAWC_LIBFUZZER
+int main(int argc, char** argv) {
+	uint64_t iterations = 100000, seed = 1;
+	size_t maxLen = 4096;
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; ++i) {
+		std::string a = argv[i];
+		if (a.rfind("--iterations=", 0) == 0) iterations = strtoull(a.c_str() + 13, nullptr, 10);
+		else if (a.rfind("--seed=", 0) == 0) seed = strtoull(a.c_str() + 7, nullptr, 10);
+		else if (a.rfind("--max-len=", 0) == 0) maxLen = (size_t)strtoull(a.c_str() + 10, nullptr, 10);
+		else if (a.size() > 1 && a[0] == '-') {
+			fprintf(stderr, "usage: fuzz_kernels [--iterations=N] [--seed=N] [--max-len=N] [corpus files...]\n");
+			return 2;
+		}
+		else files.push_back(a);
+	}
+
+	for (const auto& path : files) {
+		FILE* f = fopen(path.c_str(), "rb");
+		if (!f) { fprintf(stderr, "fuzz_kernels: cannot open %s\n", path.c_str()); return 1; }
+		std::vector<uint8_t> data;
+		uint8_t chunk[65536];
+		size_t n;
+		while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) data.insert(data.end(), chunk, chunk + n);
+		fclose(f);
+		LLVMFuzzerTestOneInput(data.data(), data.size());
+	}
+	if (!files.empty()) return 0;
+
+	// Random inputs biased towards the bytes the kernels classify.
+	static const uint8_t kInteresting[] = { ' ', '\n', '\t', '\r', '\v', '\f', 'a', 'Z', 0x00, 0x7F,
+		0x80, 0xBF, 0xC2, 0xDF, 0xE0, 0xEF, 0xF0, 0xF4, 0xFF };
+	std::vector<uint8_t> data;
+	for (uint64_t it = 0; it < iterations; ++it) {
+		size_t len = 9 + (size_t)(splitmix(seed) % (maxLen + 1));
+		data.resize(len);
+		uint64_t mode = splitmix(seed) % 4;
+		size_t zeros = 0;
+		for (size_t i = 0; i < len; ++i) {
+			uint64_t r = splitmix(seed);
+			if (mode == 3 && zeros == 0 && (r & 31) == 0) zeros = 1 + (r >> 8) % 200;
+			if (i < 9 || mode == 0) data[i] = (uint8_t)r;
+			else if (zeros) { data[i] = 0; --zeros; }
+			else if (mode == 1) data[i] = kInteresting[(r >> 8) % sizeof(kInteresting)];
+			else data[i] = (r & 7) ? (uint8_t)('a' + (r >> 8) % 26) : kInteresting[(r >> 8) % 6];
+		}
+		LLVMFuzzerTestOneInput(data.data(), data.size());
+	}
+	printf("fuzz_kernels: %llu inputs, %zu kernels agree\n", (unsigned long long)iterations, gKernels.size());
+	return 0;
+}
+#endif
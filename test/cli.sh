@@ -0,0 +1,132 @@
+#!/bin/sh
+# End-to-end checks of the fastawc binary: sh test/cli.sh CASE FASTAWC
+# [EMULATOR...]. Each case builds its inputs in a scratch directory and
+# exits non-zero with a message on the first mismatch.
+set -u
+CASE=$1
+BINARY=$2
+shift 2
+EMULATOR="$*"
+DIR=$(mktemp -d "${TMPDIR:-/tmp}/fastawc-test.XXXXXX") || exit 1
+trap 'rm -rf "$DIR"' EXIT
+
+fastawc() {
+	$EMULATOR "$BINARY" "$@"
+}
+
+fail() {
+	echo "cli.sh $CASE: $*" >&2
+	exit 1
+}
+
+# put FILE OFFSET STRING: write STRING (printf escapes) into FILE at OFFSET.
+put() {
+	printf "$3" | dd of="$1" bs=1 seek="$2" conv=notrunc 2>/dev/null
+}
+
+# tarHeader FILE NAME SIZE TYPE: a 512-byte ustar header, SIZE in octal.
+tarHeader() {
+	head -c 512 /dev/zero > "$1"
+	put "$1" 0 "$2"
+	put "$1" 100 0000644
+	put "$1" 124 "$3"
+	put "$1" 148 '        '
+	put "$1" 156 "$4"
+	put "$1" 257 ustar
+	put "$1" 263 00
+	sum=$(od -An -v -tu1 "$1" | awk '{ for (i = 1; i <= NF; ++i) s += $i } END { print s }')
+	put "$1" 148 "$(printf '%06o' "$sum")"
+	put "$1" 154 '\0'
+}
+
+# le VALUE BYTES: VALUE as BYTES little-endian bytes.
+le() {
+	v=$1
+	i=0
+	while [ $i -lt $2 ]; do
+		printf "\\$(printf %03o $((v % 256)))"
+		v=$((v / 256))
+		i=$((i + 1))
+	done
+}
+
+# zipMember ZIP NAME METHOD DATA: appends a member (DATA taken as is, CRC
+# left zero) to ZIP and its central directory entry to ZIP.cd.
+zipMember() {
+	touch "$1" "$1.cd"
+	offset=$(wc -c < "$1")
+	size=$(printf '%s' "$4" | wc -c)
+	{ printf 'PK\003\004'; le 20 2; le 0 2; le $3 2; le 0 8; le $size 4; le $size 4
+	  le ${#2} 2; le 0 2; printf '%s%s' "$2" "$4"; } >> "$1"
+	{ printf 'PK\001\002'; le 20 2; le 20 2; le 0 2; le $3 2; le 0 8; le $size 4; le $size 4
+	  le ${#2} 2; le 0 8; le 0 4; le $offset 4; printf '%s' "$2"; } >> "$1.cd"
+}
+
+# zipEnd ZIP COUNT: appends the central directory and the end record.
+zipEnd() {
+	offset=$(wc -c < "$1")
+	size=$(wc -c < "$1.cd")
+	cat "$1.cd" >> "$1"
+	{ printf 'PK\005\006'; le 0 4; le $2 2; le $2 2; le $size 4; le $offset 4; le 0 2; } >> "$1"
+}
+
+case $CASE in
+tar_ext_header)
+	# A pax header claiming 8 GiB must be rejected, not allocated.
+	for type in x L; do
+		tarHeader "$DIR/h" PaxHeader 77777777777 "$type"
+		cat "$DIR/h" /dev/zero | head -c 2048 > "$DIR/a.tar"
+		for mem in "" --max-memory=1M; do
+			fastawc --tar $mem "$DIR/a.tar" > "$DIR/out" 2> "$DIR/err"
+			rc=$?
+			[ $rc -lt 128 ] || fail "type $type $mem: killed by signal ($rc)"
+			grep -q "corrupt tar header" "$DIR/err" || fail "type $type $mem: $(cat "$DIR/err")"
+		done
+	done
+	;;
+passthrough)
+	# The copy must be byte-identical and the counts must go to stderr,
+	# whichever copy path is taken: copy_file_range (file to file),
+	# sendfile (file to pipe) or read/write (-lw, or stdin).
+	seq 1 400000 | awk '{ printf "%s w%d\t", $0, $0 % 7; if ($0 % 5 == 0) print "" }' > "$DIR/in"
+	printf 'no newline at the end' >> "$DIR/in"
+	for flags in -c -lw; do
+		want=$(fastawc $flags "$DIR/in")
+		wantStdin=$(fastawc $flags < "$DIR/in")
+		fastawc --passthrough $flags "$DIR/in" > "$DIR/out" 2> "$DIR/err" || fail "$flags file: exit $?"
+		cmp -s "$DIR/in" "$DIR/out" || fail "$flags file: copy differs"
+		[ "$(cat "$DIR/err")" = "$want" ] || fail "$flags file: counts $(cat "$DIR/err")"
+		rm -f "$DIR/out"
+		fastawc $flags --output="$DIR/out" "$DIR/in" 2> "$DIR/err" > "$DIR/stdout" || fail "$flags --output: exit $?"
+		cmp -s "$DIR/in" "$DIR/out" || fail "$flags --output: copy differs"
+		[ -s "$DIR/stdout" ] && fail "$flags --output: wrote to stdout"
+		[ "$(cat "$DIR/err")" = "$want" ] || fail "$flags --output: counts $(cat "$DIR/err")"
+		fastawc --passthrough $flags "$DIR/in" 2> "$DIR/err" | cat > "$DIR/out"
+		cmp -s "$DIR/in" "$DIR/out" || fail "$flags pipe: copy differs"
+		[ "$(cat "$DIR/err")" = "$want" ] || fail "$flags pipe: counts $(cat "$DIR/err")"
+		cat "$DIR/in" | fastawc --passthrough $flags > "$DIR/out" 2> "$DIR/err" || fail "$flags stdin: exit $?"
+		cmp -s "$DIR/in" "$DIR/out" || fail "$flags stdin: copy differs"
+		[ "$(cat "$DIR/err")" = "$wantStdin" ] || fail "$flags stdin: counts $(cat "$DIR/err")"
+	done
+	;;
+zip_bad_member)
+	# A corrupt deflate member and a bzip2 one are reported, the good member
+	# is still counted, and the exit status is 1.
+	zipMember "$DIR/a.zip" ok.txt 0 "one two
+"
+	zipMember "$DIR/a.zip" bad.txt 8 "$(printf '\377\377\377\377')"
+	zipMember "$DIR/a.zip" bz.txt 12 "BZh9"
+	zipEnd "$DIR/a.zip" 3
+	fastawc --zip "$DIR/a.zip" > "$DIR/out" 2> "$DIR/err"
+	rc=$?
+	[ $rc -eq 1 ] || fail "exit $rc, want 1"
+	[ "$(cat "$DIR/out")" = "1 2 8 $DIR/a.zip:ok.txt" ] || fail "counts $(cat "$DIR/out")"
+	grep -q "a.zip:bad.txt: " "$DIR/err" || fail "bad.txt not reported: $(cat "$DIR/err")"
+	grep -q "a.zip:bz.txt: unsupported compression method 12" "$DIR/err" || fail "bz.txt not reported: $(cat "$DIR/err")"
+	grep -q "a.zip: 2 members could not be counted" "$DIR/err" || fail "no summary: $(cat "$DIR/err")"
+	;;
+*)
+	fail "unknown case"
+	;;
+esac
+exit 0
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../fastawc/checksum.h"
+
+// Known answers for every --checksum algorithm on the input byte i % 251
+// (the BLAKE3 test-vector pattern), at the sizes where the implementations
+// change paths: XXH3's 16/128/240-byte short inputs and 1 KiB stripe
+// blocks, BLAKE3's 1 KiB chunks and the eight-chunk groups hashed with
+// AVX2. Each input is hashed whole, in uneven pieces and in 1 KiB pieces,
+// which never reach the eight-chunk path.
+
+struct Vector {
+	size_t size;
+	const char* crc32c;
+	const char* xxh3;
+	const char* blake3;
+};
+
+static const Vector kVectors[] = {
+	{ 0, "00000000", "2d06800538d394c2",
+		"af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262" },
+	{ 1, "527d5351", "c44bdff4074eecdb",
+		"2d3adedff11b61f14c886e35afa036736dcd87a74d27b5c1510225d0f592e213" },
+	{ 3, "92fd4bfa", "5f4299fc161c9cbb",
+		"e1be4d7a8ab5560aa4199eea339849ba8e293d55ca0a81006726d184519e647f" },
+	{ 4, "d9331aa3", "60dab036a58211f2",
+		"f30f5ab28fe047904037f77b6da4fea1e27241c5d132638d8bedce9d40494f32" },
+	{ 8, "8a2cbc3b", "3a1c2d7c85af88f8",
+		"2351207d04fc16ade43ccab08600939c7c1fa70a5c0aaca76063d04c3228eaeb" },
+	{ 9, "7144c5a8", "e9612598145bb9dc",
+		"a0fc27e5d7318b723207637bdeeba4f7dcb22f7f9ec3e8b6f3588ddcd4fdf861" },
+	{ 16, "d9c908eb", "8355e3a6f61770db",
+		"a6a492965517a830cb75fdb713465aa465f2f098233896fea44c1d98268bf9e3" },
+	{ 17, "38435e17", "9ef341a99de37328",
+		"8462aa7be93b09fda7b93cf9f9cddb703f6dd2cc0c8edd5f9eee092edf8abf0c" },
+	{ 128, "30d9c515", "85c6174c7ff4c46b",
+		"f17e570564b26578c33bb7f44643f539624b05df1a76c81f30acd548c44b45ef" },
+	{ 129, "f514629f", "ec7642b431ba3e5a",
+		"683aaae9f3c5ba37eaaf072aed0f9e30bac0865137bae68b1fde4ca2aebdcb12" },
+	{ 240, "9f4f71d6", "375a384d957fe865",
+		"45e1a0dc23dbe51733d7269a3c0f519c2a63b0718835b2b537677eba734db0d8" },
+	{ 241, "54fe7516", "02e8cd95421c6d02",
+		"749b36ae651c22e8567db692a6876e0ca4fd3daeb7aa8fa3ab2f642ccc69a8f6" },
+	{ 1023, "39a4911a", "d3d91d80ac495685",
+		"10108970eeda3eb932baac1428c7a2163b0e924c9a9e25b35bba72b28f70bd11" },
+	{ 1024, "2af62c0c", "e5d78bafa45b2aa5",
+		"42214739f095a406f3fc83deb889744ac00df831c10daa55189b5d121c855af7" },
+	{ 1025, "c8d03add", "e95c42288f28186e",
+		"d00278ae47eb27b34faecf67b4fe263f82d5412916c1ffd97c8cb7fb814b8444" },
+	{ 2048, "9f7e33f0", "25339063db861586",
+		"e776b6028c7cd22a4d0ba182a8bf62205d2ef576467e838ed6f2529b85fba24a" },
+	{ 2049, "0be89406", "6c9600c0e506e2ae",
+		"5f4d72f40d7a5f82b15ca2b2e44b1de3c2ef86c426c95c1af0b6879522563030" },
+	{ 8192, "5372b398", "40a71c16bbe37322",
+		"aae792484c8efe4f19e2ca7d371d8c467ffb10748d8a5a1ae579948f718a2a63" },
+	{ 8193, "e814309c", "d6735a2b792cf505",
+		"bab6c09cb8ce8cf459261398d2e7aef35700bf488116ceb94a36d0f5f1b7bc3b" },
+	{ 9217, "d98c5cd2", "cf52da2f1074ce56",
+		"d42c90aa30bee83ecb52ad31b685d566145649496764878873598cef582d4d8f" },
+	{ 102400, "7957da17", "1428e17f1cac2837",
+		"bc3e3d41a1146b069abffad3c0d44860cf664390afce4d9661f7902e7943e085" },
+};
+
+// pieces: 0 for the whole input at once, SIZE_MAX for uneven pieces,
+// otherwise pieces of that size.
+static std::string digest(Checksum::Algorithm algo, const std::vector<unsigned char>& in, size_t pieces) {
+	static const size_t kUneven[] = { 1, 63, 64, 65, 239, 1000, 7, 3000, 16, 9000 };
+	Checksum sum(algo);
+	for (size_t off = 0, i = 0; off < in.size(); ++i) {
+		size_t n = pieces == 0 ? in.size() : pieces == SIZE_MAX ? kUneven[i % 10] : pieces;
+		n = std::min(n, in.size() - off);
+		sum.update(in.data() + off, n);
+		off += n;
+	}
+	return sum.hex();
+}
+
+int main() {
+	int failures = 0;
+	{
+		const std::string check = "123456789";
+		Checksum sum(Checksum::kCrc32c);
+		sum.update((const unsigned char*)check.data(), check.size());
+		if (sum.hex() != "e3069283") {
+			fprintf(stderr, "test_checksum: crc32c(\"123456789\") = %s, want e3069283\n", sum.hex().c_str());
+			++failures;
+		}
+	}
+	for (const Vector& v : kVectors) {
+		std::vector<unsigned char> in(v.size);
+		for (size_t i = 0; i < v.size; ++i) in[i] = (unsigned char)(i % 251);
+		const struct {
+			Checksum::Algorithm algo;
+			const char* name;
+			const char* want;
+		} cases[] = {
+			{ Checksum::kCrc32c, "crc32c", v.crc32c },
+			{ Checksum::kXxh3, "xxh3", v.xxh3 },
+			{ Checksum::kBlake3, "blake3", v.blake3 },
+		};
+		for (const auto& c : cases) {
+			for (size_t pieces : { (size_t)0, SIZE_MAX, (size_t)1024 }) {
+				std::string got = digest(c.algo, in, pieces);
+				if (got == c.want) continue;
+				fprintf(stderr, "test_checksum: %s of %zu bytes (%s) = %s, want %s\n", c.name, v.size,
+					pieces == 0 ? "whole" : pieces == SIZE_MAX ? "uneven pieces" : "1 KiB pieces", got.c_str(), c.want);
+				++failures;
+			}
+		}
+	}
+	if (failures) return 1;
+	printf("test_checksum: %zu vectors match\n", sizeof(kVectors) / sizeof(kVectors[0]));
+	return 0;
+}
@@ -0,0 +1,93 @@
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "../fastawc/count.h"
+
+// countSmallFiles against countStream, file by file, with every kernel and
+// checksum. One file of each batch is given a stale (smaller) size, as if
+// it grew after it was opened: it must be counted again from the start
+// without disturbing the digests of the files read alongside it.
+
+static std::string makeText(size_t n, unsigned seed) {
+	static const char kWords[] = "lorem ipsum\tdolor\nsit  amet \xC3\xA9t\xE2\x82\xAC\n";
+	std::string s;
+	for (size_t i = 0; i < n; ++i) s += kWords[(i * 7 + seed + i / 13) % (sizeof(kWords) - 1)];
+	return s;
+}
+
+static bool sameCounts(const Counts& a, const Counts& b) {
+	return a.lineCount == b.lineCount && a.wordCount == b.wordCount && a.byteCount == b.byteCount
+		&& a.charCount == b.charCount && a.maxLineLength == b.maxLineLength;
+}
+
+int main() {
+	initSpaceTable();
+	namespace fs = std::filesystem;
+	fs::path dir = fs::temp_directory_path() / ("fastawc-small-" + std::to_string((unsigned long long)
+		std::chrono::steady_clock::now().time_since_epoch().count()));
+	fs::create_directories(dir);
+	std::vector<std::string> paths;
+	const size_t sizes[kMaxStreams] = { 3000, 70, 5000, 1234 };
+	for (size_t i = 0; i < kMaxStreams; ++i) {
+		paths.push_back((dir / ("f" + std::to_string(i))).string());
+		std::string text = makeText(sizes[i], (unsigned)i);
+		FILE* f = fopen(paths[i].c_str(), "wb");
+		if (!f || fwrite(text.data(), 1, text.size(), f) != text.size() || fclose(f) != 0) {
+			fprintf(stderr, "test_small_files: cannot write %s\n", paths[i].c_str());
+			return 1;
+		}
+	}
+
+	int failures = 0;
+	size_t kernels = 0;
+	for (const KernelInfo* k : allKernels()) {
+		if (!k->supported()) continue;
+		++kernels;
+		for (Checksum::Algorithm algo : { Checksum::kNone, Checksum::kCrc32c, Checksum::kXxh3, Checksum::kBlake3 }) {
+			for (size_t grown = 0; grown <= kMaxStreams; ++grown) {
+				Options opt;
+				opt.optLines = opt.optWords = opt.optBytes = opt.optChars = opt.optMaxLine = true;
+				opt.checksum = algo;
+				opt.bufSize = 64u << 10;
+				std::vector<unsigned char> buffer(opt.bufSize);
+				std::vector<SmallFile> batch;
+				for (size_t i = 0; i < kMaxStreams; ++i) {
+					SmallFile s;
+					s.path = paths[i];
+					s.f = openInput(paths[i]);
+					s.r.opened = s.f != nullptr;
+					if (!s.f || !isSmallFile(s.f, opt, s.size)) {
+						fprintf(stderr, "test_small_files: %s is not a small file\n", paths[i].c_str());
+						return 1;
+					}
+					// grown == kMaxStreams: none did.
+					if (i == grown) s.size -= 50;
+					batch.push_back(std::move(s));
+				}
+				countSmallFiles(batch, *k, buffer, opt);
+				for (size_t i = 0; i < kMaxStreams; ++i) {
+					FileResult want;
+					FILE* f = openInput(paths[i]);
+					Checksum sum(algo);
+					countStream(f, *k, buffer, opt, want.counts, want.stats, nullptr,
+						algo != Checksum::kNone ? &sum : nullptr);
+					closeInput(f);
+					want.checksum = sum.hex();
+					const FileResult& got = batch[i].r;
+					if (got.opened && sameCounts(got.counts, want.counts) && got.checksum == want.checksum) continue;
+					fprintf(stderr, "test_small_files: %s, checksum %d, file %zu grown: file %zu differs"
+						" (bytes %llu/%llu, digest %s/%s)\n", k->name, (int)algo, grown, i,
+						(unsigned long long)got.counts.byteCount, (unsigned long long)want.counts.byteCount,
+						got.checksum.c_str(), want.checksum.c_str());
+					++failures;
+				}
+			}
+		}
+	}
+	fs::remove_all(dir);
+	if (failures) return 1;
+	printf("test_small_files: %zu kernels agree\n", kernels);
+	return 0;
+}